@@ -17,7 +17,7 @@ STMLIBDIR   = $(EURORACKDIR)/stmlib
 CSRC = header.c
 
 # C++ sources
-CXXSRC = unit.cc digital_oscillator.cc $(BRAIDSDIR)/resources.cc $(BRAIDSDIR)/quantizer.cc $(BRAIDSDIR)/macro_oscillator.cc $(BRAIDSDIR)/analog_oscillator.cc $(STMLIBDIR)/utils/random.cc
+CXXSRC = unit.cc unison.cc digital_oscillator.cc $(BRAIDSDIR)/resources.cc $(BRAIDSDIR)/quantizer.cc $(BRAIDSDIR)/macro_oscillator.cc $(BRAIDSDIR)/analog_oscillator.cc $(STMLIBDIR)/utils/random.cc
 
 # List ASM source files here
 ASMSRC = 
@@ -28,7 +28,8 @@ ASMXSRC =
 # Include Paths
 #
 
-UINCDIR  = $(EURORACKDIR) $(STMLIBDIR) $(STMLIBDIR)/third_party/STM $(STMLIBDIR)/third_party/STM/STM32F10x_StdPeriph_Driver/inc/ $(STMLIBDIR)/third_party/STM/CMSIS/CM3_f10x
+# patch/ holds patched copies of submodule headers, found before the originals
+UINCDIR  = patch $(EURORACKDIR) $(STMLIBDIR) $(STMLIBDIR)/third_party/STM $(STMLIBDIR)/third_party/STM/STM32F10x_StdPeriph_Driver/inc/ $(STMLIBDIR)/third_party/STM/CMSIS/CM3_f10x
 
 ##############################################################################
 # Library Paths
@@ -46,6 +47,16 @@ ULIBS += -lc
 ##############################################################################
 # Macros
 #
+# -DLILLIAN_RENDER_STATS  per-stage timing of Synth::Render (render_stats.h)
+# -DLILLIAN_CONTROL_BLOCK_SIZE=n  samples per envelope/modulation update (default 24)
+# -DLILLIAN_VOICES=n  size of the voice pool (default 1, monophonic)
+# -DLILLIAN_LOAD_BUDGET=n  CPU share the voices may use, in percent (default 80, 0: no
+#                          voice stealing or longer control blocks); the load is read
+#                          from hidden parameter 32
+# -DLILLIAN_UNISON=n  most detuned oscillator copies per voice (default 1: no unison;
+#                     each copy costs a MacroOscillator per voice); 8 here, for the
+#                     unit and the host tools alike
+#
 
-UDEFS = 
+UDEFS = -DLILLIAN_UNISON=8
 
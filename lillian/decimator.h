@@ -0,0 +1,74 @@
+#pragma once
+/*
+ *  File: decimator.h
+ *
+ *  sample rate and bit depth reducer
+ *
+ *  Holds every factor-th sample, masked to the selected bit depth, for the
+ *  following factor - 1 samples. The phase is a countdown, so there is no
+ *  division per sample, and it can be reset so that a note always starts
+ *  on a fresh sample.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+class Decimator {
+public:
+    void Init() {
+        count_ = 0;
+        held_ = 0;
+    }
+
+    // The next sample is taken.
+    inline void Reset() {
+        count_ = 0;
+    }
+
+    // Reduces a block rendered at the full rate, in place.
+    inline void Process(int16_t * buf, size_t size, uint16_t factor, uint16_t mask) {
+        setFactor(factor);
+        for (size_t i = 0; i < size; i++) {
+            if (count_ == 0) {
+                held_ = buf[i] & mask;
+                count_ = factor;
+            }
+            count_--;
+            buf[i] = held_;
+        }
+    }
+
+    // Number of samples the next size output samples take, i.e. how many
+    // samples to render at the reduced rate for Hold().
+    inline size_t Takes(size_t size, uint16_t factor) {
+        setFactor(factor);
+        return (count_ < size) ? (size - 1 - count_) / factor + 1 : 0;
+    }
+
+    // Same output as Process(), from the Takes(size, factor) samples of a
+    // block rendered at the reduced rate.
+    inline void Hold(const int16_t * in, int16_t * out, size_t size,
+                     uint16_t factor, uint16_t mask) {
+        setFactor(factor);
+        for (size_t i = 0; i < size; i++) {
+            if (count_ == 0) {
+                held_ = *in++ & mask;
+                count_ = factor;
+            }
+            count_--;
+            out[i] = held_;
+        }
+    }
+
+private:
+    inline void setFactor(uint16_t factor) {
+        if (count_ >= factor) {
+            // the factor was lowered since the last block
+            count_ = factor - 1;
+        }
+    }
+
+    uint16_t count_;
+    int16_t held_;
+};
@@ -1525,6 +1525,24 @@ static const WavetableDefinition wavetable_definitions[] = {
 { 4 , { 252, 253, 254, 255, 254 } },
 };
 
+// lillian: the waves RenderWavetables crossfades, shared with the unison
+// kernel in unison.cc. parameter_1 is after the hysteresis.
+void WavetableWaves(
+    int16_t parameter_0,
+    int16_t parameter_1,
+    const uint8_t** wave,
+    uint32_t* wave_pointer) {
+  uint32_t wavetable_index = static_cast<uint32_t>(parameter_1) * 20;
+  wavetable_index >>= 15;
+  const WavetableDefinition& wt = wavetable_definitions[wavetable_index];
+
+  *wave_pointer = (parameter_0 << 1) * wt.num_steps;
+  for (size_t i = 0; i < 2; ++i) {
+    size_t wave_index = wt.wave_index[(*wave_pointer >> 16) + i];
+    wave[i] = wt_waves + wave_index * 129;
+  }
+}
+
 void DigitalOscillator::RenderWavetables(
     const uint8_t* sync,
     int16_t* buffer,
@@ -1536,18 +1554,9 @@ void DigitalOscillator::RenderWavetables(
     previous_parameter_[1] = parameter_[1];
   }
       
-  uint32_t wavetable_index = static_cast<uint32_t>(previous_parameter_[1]) * 20;
-  wavetable_index >>= 15;
-  
   uint32_t wave_pointer;
   const uint8_t* wave[2];
-  const WavetableDefinition& wt = wavetable_definitions[wavetable_index];
-  
-  wave_pointer = (parameter_[0] << 1) * wt.num_steps;
-  for (size_t i = 0; i < 2; ++i) {
-    size_t wave_index = wt.wave_index[(wave_pointer >> 16) + i];
-    wave[i] = wt_waves + wave_index * 129;
-  }
+  WavetableWaves(parameter_[0], previous_parameter_[1], wave, &wave_pointer);
 
   uint32_t phase_increment = phase_increment_ >> 1;
   while (size--) {
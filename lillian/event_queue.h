@@ -0,0 +1,66 @@
+#pragma once
+/*
+ *  File: event_queue.h
+ *
+ *  single-producer single-consumer event ring
+ *
+ *  Carries events from the thread calling the unit_* callbacks to the
+ *  render thread without locks: each side only writes its own index, so
+ *  Push and Pop never block and never allocate. N must be a power of 2;
+ *  the ring holds N - 1 events.
+ *
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+template <typename T, size_t N>
+class EventQueue {
+    static_assert((N & (N - 1)) == 0, "EventQueue size must be a power of 2");
+
+public:
+    // Not thread safe: only while neither side is running.
+    void Init() {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+    }
+
+    // Producer: false if the ring is full.
+    inline bool Push(const T & e) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t next = (head + 1) & (N - 1);
+        if (next == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        ring_[head] = e;
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: the next event, left in the ring. False if it is empty.
+    inline bool Peek(T & e) const {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        e = ring_[tail];
+        return true;
+    }
+
+    // Consumer: false if the ring is empty.
+    inline bool Pop(T & e) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        e = ring_[tail];
+        tail_.store((tail + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+private:
+    T ring_[N];
+    std::atomic<size_t> head_;  // written by the producer
+    std::atomic<size_t> tail_;  // written by the consumer
+};
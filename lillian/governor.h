@@ -0,0 +1,149 @@
+#pragma once
+/*
+ *  File: governor.h
+ *
+ *  CPU budget of Synth::Render
+ *
+ *  Times every Render call against its realtime deadline and every voice
+ *  rendered in it, and keeps smoothed figures of the load (render time /
+ *  deadline) and of the load of one voice. Synth limits the number of
+ *  sounding voices with them: over the budget it steals a voice, and it
+ *  lets one more sound again only once the load leaves room for an
+ *  average voice. When only one voice sounds, it doubles the control
+ *  block instead (coarse), up to twice, and goes back once the load is
+ *  under half the budget, before letting more voices sound. The load can
+ *  be read from any thread.
+ *
+ *  With a single voice only the calls are timed, not the voice.
+ *
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "monotonic.h"
+
+// Share of the deadline the voices may use, in percent; 0 disables the
+// governor.
+#ifndef LILLIAN_LOAD_BUDGET
+#define LILLIAN_LOAD_BUDGET 80
+#endif
+
+template <size_t kMaxVoices>
+class LoadGovernor {
+public:
+    static constexpr float kBudget = LILLIAN_LOAD_BUDGET / 100.f;
+    static constexpr float kSmoothing = 1.f / 16;  // per Render call
+    static const uint32_t kHoldCalls = 32;          // between two changes of the limit
+    static const uint32_t kMaxCoarse = 2;           // control block up to 4 times longer
+
+    void Init(uint32_t sample_rate) {
+        ns_per_frame_ = 1e9f / sample_rate;
+        limit_ = kMaxVoices;
+        coarse_ = 0;
+        load_ = 0;
+        voice_load_ = 0;
+        voice_ns_ = 0;
+        voice_frames_ = 0;
+        hold_ = 0;
+        load_permille_.store(0, std::memory_order_relaxed);
+    }
+
+    // Render thread: at the start of a Render call.
+    inline void BeginCall() {
+        call_start_ = now_ns();
+    }
+
+    // Render thread: around the rendering of frames frames of a voice.
+    // Only needed to know what a voice costs before letting one more
+    // sound.
+    inline void BeginVoice() {
+        if (kMaxVoices > 1) {
+            voice_start_ = now_ns();
+        }
+    }
+
+    inline void EndVoice(size_t frames) {
+        if (kMaxVoices > 1) {
+            voice_ns_ += now_ns() - voice_start_;
+            voice_frames_ += frames;
+        }
+    }
+
+    // Render thread: at the end of a call of frames frames. Returns true
+    // if a voice should be stolen, and updates the limit on sounding
+    // voices and the coarse level. A call without frames has no deadline
+    // and is not counted.
+    inline bool EndCall(size_t frames, size_t sounding) {
+        if (frames == 0) {
+            return false;
+        }
+        const uint64_t ns = now_ns() - call_start_;
+        const float deadline = frames * ns_per_frame_;
+        load_ += (ns / deadline - load_) * kSmoothing;
+        if (voice_frames_) {
+            const float voice_load = voice_ns_ / (voice_frames_ * ns_per_frame_);
+            voice_load_ += (voice_load - voice_load_) * kSmoothing;
+        }
+        voice_ns_ = 0;
+        voice_frames_ = 0;
+        load_permille_.store(static_cast<uint32_t>(load_ * 1000), std::memory_order_relaxed);
+
+        if (kBudget <= 0 || (hold_ && --hold_)) {
+            return false;
+        }
+        if (load_ > kBudget) {
+            if (sounding > 1) {
+                limit_ = sounding - 1;
+                hold_ = kHoldCalls;
+                return true;
+            }
+            if (coarse_ < kMaxCoarse) {
+                coarse_++;
+                hold_ = kHoldCalls;
+            }
+            return false;
+        }
+        if (coarse_ > 0) {
+            if (load_ < kBudget / 2) {
+                coarse_--;
+                hold_ = kHoldCalls;
+            }
+            return false;
+        }
+        if (limit_ < kMaxVoices && load_ + voice_load_ < kBudget) {
+            limit_++;
+            hold_ = kHoldCalls;
+        }
+        return false;
+    }
+
+    // Voices allowed to sound at the same time.
+    inline size_t limit() const {
+        return limit_;
+    }
+
+    // Control block = the set one << coarse().
+    inline uint32_t coarse() const {
+        return coarse_;
+    }
+
+    // Any thread: smoothed render time / deadline, in 1/1000.
+    inline uint32_t load() const {
+        return load_permille_.load(std::memory_order_relaxed);
+    }
+
+private:
+    float ns_per_frame_;
+    size_t limit_;
+    uint32_t coarse_;
+    float load_;
+    float voice_load_;  // of a single voice
+    uint64_t call_start_;
+    uint64_t voice_start_;
+    uint64_t voice_ns_;
+    uint64_t voice_frames_;
+    uint32_t hold_;
+    std::atomic<uint32_t> load_permille_;
+};
@@ -0,0 +1,254 @@
+/*
+ *  File: batch.cc
+ *
+ *  multi-core sample library renderer
+ *
+ *  Renders one WAV file per preset x note x velocity. Each job renders a
+ *  fresh Synth instance (instance.h), so the files do not depend on the
+ *  number of worker threads or on which worker took the job. The workers
+ *  take jobs from a work-stealing queue, streaming the output to disk as
+ *  it is rendered.
+ *
+ *  usage: batch [-p presets] [-n notes] [-v velocities] [-g seconds]
+ *               [-r seconds] [-j threads] [-o dir]
+ *
+ *  Lists are comma separated numbers or first:last[:step] ranges,
+ *  e.g. -n 36:84:12 -v 40,80,127.
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "unit.h"
+#include "instance.h"
+
+#include "unit_host.h"
+#include "wav.h"
+#include "work_queue.h"
+
+constexpr size_t kChunkFrames = kHostDefaultFrames;
+
+struct Job {
+    uint8_t preset;
+    uint8_t note;
+    uint8_t velocity;
+};
+
+struct Options {
+    std::vector<int> presets;
+    std::vector<int> notes;
+    std::vector<int> velocities;
+    double gate_sec;
+    double release_sec;
+    unsigned threads;
+    const char * dir;
+};
+
+struct WorkerStats {
+    uint32_t jobs;
+    uint32_t stolen;
+    uint32_t failed;
+    uint64_t frames;
+};
+
+// Parses "1,2,5:9,10:20:5" into a list of values within [min, max].
+static bool parse_list(const char * s, int min, int max, std::vector<int> & out) {
+    out.clear();
+    while (*s) {
+        char * end;
+        int first = std::strtol(s, &end, 10);
+        int last = first;
+        int step = 1;
+        if (end == s) {
+            return false;
+        }
+        if (*end == ':') {
+            s = end + 1;
+            last = std::strtol(s, &end, 10);
+            if (*end == ':') {
+                s = end + 1;
+                step = std::strtol(s, &end, 10);
+            }
+        }
+        if (first < min || last > max || first > last || step < 1) {
+            return false;
+        }
+        for (int v = first; v <= last; v += step) {
+            out.push_back(v);
+        }
+        if (*end == ',') {
+            end++;
+        } else if (*end) {
+            return false;
+        }
+        s = end;
+    }
+    return !out.empty();
+}
+
+static bool render_job(const unit_runtime_desc_t & desc, const Job & job,
+                       const Options & opt, uint64_t & frames) {
+    char path[512];
+    std::snprintf(path, sizeof(path), "%s/%02d_%s_n%03d_v%03d.wav", opt.dir,
+                  job.preset, Synth::getPresetName(job.preset), job.note, job.velocity);
+    Synth * synth = lillian_create(desc);
+    if (!synth) {
+        std::fprintf(stderr, "%s: cannot create an instance\n", path);
+        return false;
+    }
+    WavWriter wav;
+    if (!wav.Open(path, kHostSampleRate, 2)) {
+        std::fprintf(stderr, "%s: cannot open\n", path);
+        lillian_destroy(synth);
+        return false;
+    }
+
+    synth->LoadPreset(job.preset);
+    synth->NoteOn(job.note, job.velocity);
+
+    float buf[kChunkFrames * 2];
+    const uint64_t gate_frames = static_cast<uint64_t>(opt.gate_sec * kHostSampleRate);
+    const uint64_t total_frames = gate_frames +
+        static_cast<uint64_t>(opt.release_sec * kHostSampleRate);
+    for (uint64_t pos = 0; pos < total_frames; pos += kChunkFrames) {
+        if (pos <= gate_frames && gate_frames < pos + kChunkFrames) {
+            synth->NoteOff(job.note);
+        }
+        size_t n = std::min<uint64_t>(kChunkFrames, total_frames - pos);
+        lillian_render(synth, buf, n);
+        wav.Write(buf, n);
+    }
+    lillian_destroy(synth);
+    wav.Close();
+    frames += total_frames;
+    return true;
+}
+
+static void worker(size_t id, WorkStealingQueue<Job> & queue,
+                   const Options & opt, WorkerStats & stats) {
+    unit_runtime_desc_t desc = {};
+    desc.samplerate = kHostSampleRate;
+    desc.frames_per_buffer = kChunkFrames;
+    desc.output_channels = 2;
+
+    Job job;
+    bool stolen;
+    while (queue.Pop(id, job, stolen)) {
+        stats.jobs++;
+        stats.stolen += stolen;
+        if (!render_job(desc, job, opt, stats.frames)) {
+            stats.failed++;
+        }
+    }
+}
+
+static void usage() {
+    std::fprintf(stderr,
+                 "usage: batch [-p presets] [-n notes] [-v velocities] [-g seconds]\n"
+                 "             [-r seconds] [-j threads] [-o dir]\n"
+                 "  -p  presets (default: all)\n"
+                 "  -n  notes (default 24:96:12)\n"
+                 "  -v  velocities (default 127)\n"
+                 "  -g  gate time (default 1)\n"
+                 "  -r  release time after the gate (default 1)\n"
+                 "  -j  worker threads (default: number of cores)\n"
+                 "  -o  output directory (default: samples)\n");
+}
+
+int main(int argc, char ** argv) {
+    Options opt;
+    opt.gate_sec = 1;
+    opt.release_sec = 1;
+    opt.threads = std::max(1u, std::thread::hardware_concurrency());
+    opt.dir = "samples";
+    for (size_t i = 0; i < PRESET_COUNT; i++) {
+        opt.presets.push_back(i);
+    }
+    parse_list("24:96:12", 0, 127, opt.notes);
+    parse_list("127", 1, 127, opt.velocities);
+
+    int c;
+    while ((c = getopt(argc, argv, "p:n:v:g:r:j:o:")) != -1) {
+        bool ok = true;
+        switch (c) {
+        case 'p':
+            ok = parse_list(optarg, 0, PRESET_COUNT - 1, opt.presets);
+            break;
+        case 'n':
+            ok = parse_list(optarg, 0, 127, opt.notes);
+            break;
+        case 'v':
+            ok = parse_list(optarg, 1, 127, opt.velocities);
+            break;
+        case 'g':
+            opt.gate_sec = std::atof(optarg);
+            break;
+        case 'r':
+            opt.release_sec = std::atof(optarg);
+            break;
+        case 'j':
+            opt.threads = std::atoi(optarg);
+            break;
+        case 'o':
+            opt.dir = optarg;
+            break;
+        default:
+            ok = false;
+        }
+        if (!ok) {
+            usage();
+            return 1;
+        }
+    }
+    if (opt.threads == 0 || opt.gate_sec < 0 || opt.release_sec < 0) {
+        usage();
+        return 1;
+    }
+    mkdir(opt.dir, 0777);
+
+    WorkStealingQueue<Job> queue(opt.threads);
+    size_t num_jobs = 0;
+    for (int preset : opt.presets) {
+        for (int note : opt.notes) {
+            for (int velocity : opt.velocities) {
+                queue.Push({ uint8_t(preset), uint8_t(note), uint8_t(velocity) });
+                num_jobs++;
+            }
+        }
+    }
+
+    using clock = std::chrono::steady_clock;
+    const clock::time_point start = clock::now();
+    std::vector<WorkerStats> stats(opt.threads, WorkerStats());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < opt.threads; i++) {
+        threads.emplace_back(worker, i, std::ref(queue), std::cref(opt), std::ref(stats[i]));
+    }
+    for (std::thread & t : threads) {
+        t.join();
+    }
+    const double wall = std::chrono::duration<double>(clock::now() - start).count();
+
+    WorkerStats total = {};
+    for (size_t i = 0; i < opt.threads; i++) {
+        std::fprintf(stderr, "worker %2zu: %5u jobs (%u stolen)\n",
+                     i, stats[i].jobs, stats[i].stolen);
+        total.jobs += stats[i].jobs;
+        total.failed += stats[i].failed;
+        total.frames += stats[i].frames;
+    }
+    const double audio = static_cast<double>(total.frames) / kHostSampleRate;
+    std::fprintf(stderr, "%zu jobs, %u failed, %.1f s of audio in %.2f s (%.1fx realtime)\n",
+                 num_jobs, total.failed, audio, wall, audio / wall);
+    return total.failed ? 1 : 0;
+}
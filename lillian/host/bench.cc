@@ -0,0 +1,263 @@
+/*
+ *  File: bench.cc
+ *
+ *  per-shape oscillator benchmark
+ *
+ *  Renders every MacroOscillator shape at several pitches and
+ *  timbre/color settings in 24-sample blocks, as Synth::Render does, and
+ *  reports the mean cost per sample and the distribution of block times.
+ *  With -u, renders every shape through UnisonOscillator with 1, 2, 4 and
+ *  8 copies instead and reports the cost per number of copies, with the
+ *  kernel used (packed or sequential).
+ *
+ *  usage: bench [-b blocks] [-s shape] [-c] [-u]
+ *
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <unistd.h>
+
+#include "unit.h"
+#include "stmlib/utils/random.h"
+#include "braids/macro_oscillator.h"
+#include "unison.h"
+
+#include "clock.h"
+
+constexpr size_t kBlockSize = 24;  // size of temp_buffer in macro_oscillator.h
+constexpr size_t kWarmupBlocks = 64;
+constexpr uint8_t kShapeParam = 1;
+constexpr int kNumShapes = 47;  // range of the Shape parameter
+
+static const uint8_t kNotes[] = { 36, 60, 84 };
+static const size_t kUnisonCopies[] = { 1, 2, 4, 8 };
+constexpr uint8_t kUnisonNote = 60;
+constexpr int16_t kUnisonTimbreColor = 16384;
+constexpr int32_t kUnisonDetune = 25;  // cents
+static const int16_t kTimbreColor[][2] = {
+    { 0, 0 },
+    { 16384, 16384 },
+    { 32767, 32767 },
+};
+
+struct BenchResult {
+    double ns_per_sample;
+    double cycles_per_sample;
+    uint64_t min;
+    uint64_t median;
+    uint64_t p99;
+};
+
+static uint64_t percentile(const std::vector<uint64_t> & sorted, double p) {
+    size_t i = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+static inline void set_copies(braids::MacroOscillator &, size_t) {}
+
+static inline void set_copies(UnisonOscillator & osc, size_t copies) {
+    osc.set_unison(copies, kUnisonDetune);
+}
+
+template <typename Oscillator>
+static BenchResult bench_shape(Oscillator & osc, size_t copies,
+                               uint8_t shape, uint8_t note,
+                               int16_t timbre, int16_t color,
+                               size_t blocks, uint64_t overhead,
+                               const CycleCounter & cycles) {
+    int16_t buf[kBlockSize];
+    const uint8_t sync[kBlockSize] = {};
+    std::vector<uint64_t> times(blocks);
+
+    stmlib::Random::Seed(0x21);
+    std::memset(&osc, 0, sizeof(osc));
+    osc.Init();
+    set_copies(osc, copies);
+    osc.set_shape(static_cast<braids::MacroOscillatorShape>(shape));
+    osc.set_pitch(note << 7);
+    osc.set_parameters(timbre, color);
+    osc.Strike();
+    // the first blocks include the shape initialization and the strike
+    for (size_t i = 0; i < kWarmupBlocks; i++) {
+        osc.Render(sync, buf, kBlockSize);
+    }
+
+    uint64_t total = 0;
+    const uint64_t c0 = cycles.read();
+    for (size_t i = 0; i < blocks; i++) {
+        const uint64_t t0 = now_ns();
+        osc.Render(sync, buf, kBlockSize);
+        const uint64_t t = now_ns() - t0;
+        times[i] = t > overhead ? t - overhead : 0;
+        total += times[i];
+    }
+    const uint64_t c1 = cycles.read();
+
+    std::sort(times.begin(), times.end());
+    const double samples = static_cast<double>(blocks * kBlockSize);
+    BenchResult r;
+    r.ns_per_sample = total / samples;
+    // cycles include the timer calls; remove them in proportion
+    r.cycles_per_sample = (c1 - c0) / samples * total / (total + overhead * blocks);
+    r.min = times.front();
+    r.median = percentile(times, 0.5);
+    r.p99 = percentile(times, 0.99);
+    return r;
+}
+
+// One row per shape with the cost at each number of copies, and the cost
+// of one copy at the most copies relative to a single oscillator.
+static void bench_unison(int only_shape, size_t blocks, bool csv, uint64_t overhead,
+                         const CycleCounter & cycles) {
+    static UnisonOscillator osc;
+    size_t num_counts = 0;
+    while (num_counts < sizeof(kUnisonCopies) / sizeof(kUnisonCopies[0])
+           && kUnisonCopies[num_counts] <= UnisonOscillator::kMaxUnison) {
+        num_counts++;
+    }
+
+    if (csv) {
+        std::printf("shape,name,kernel,copies,ns_per_sample,cycles_per_sample,"
+                    "block_min_ns,block_median_ns,block_p99_ns\n");
+    } else {
+        std::printf("# %zu blocks of %zu samples per case, note %d, timbre/color %d, "
+                    "detune %d cents\n", blocks, kBlockSize, kUnisonNote,
+                    kUnisonTimbreColor, kUnisonDetune);
+        std::printf("# ns/sample per number of copies; per copy: at %zu copies, "
+                    "relative to 1\n", kUnisonCopies[num_counts - 1]);
+        std::printf("%-5s %-9s %-10s", "shape", "name", "kernel");
+        for (size_t i = 0; i < num_counts; i++) {
+            std::printf(" %7zu", kUnisonCopies[i]);
+        }
+        std::printf(" %8s\n", "per copy");
+    }
+
+    for (int shape = 0; shape < kNumShapes; shape++) {
+        if (only_shape >= 0 && shape != only_shape) {
+            continue;
+        }
+        const char * name = unit_get_param_str_value(kShapeParam, shape);
+        const char * kernel = UnisonOscillator::packed(
+            static_cast<braids::MacroOscillatorShape>(shape)) ? "packed" : "sequential";
+        double ns[sizeof(kUnisonCopies) / sizeof(kUnisonCopies[0])];
+        for (size_t i = 0; i < num_counts; i++) {
+            BenchResult r = bench_shape(osc, kUnisonCopies[i], shape, kUnisonNote,
+                                        kUnisonTimbreColor, kUnisonTimbreColor,
+                                        blocks, overhead, cycles);
+            ns[i] = r.ns_per_sample;
+            if (csv) {
+                std::printf("%d,%s,%s,%zu,%.2f,%.1f,%llu,%llu,%llu\n",
+                            shape, name, kernel, kUnisonCopies[i],
+                            r.ns_per_sample, cycles.source() ? r.cycles_per_sample : 0.,
+                            (unsigned long long)r.min,
+                            (unsigned long long)r.median,
+                            (unsigned long long)r.p99);
+            }
+        }
+        if (!csv) {
+            std::printf("%-5d %-9s %-10s", shape, name, kernel);
+            for (size_t i = 0; i < num_counts; i++) {
+                std::printf(" %7.2f", ns[i]);
+            }
+            const size_t last = num_counts - 1;
+            std::printf(" %8.2f\n", ns[last] / kUnisonCopies[last] / ns[0]);
+        }
+    }
+}
+
+static void usage() {
+    std::fprintf(stderr,
+                 "usage: bench [-b blocks] [-s shape] [-c] [-u]\n"
+                 "  -b  timed %zu-sample blocks per case (default 2000)\n"
+                 "  -s  benchmark a single shape (0..%d)\n"
+                 "  -c  CSV output\n"
+                 "  -u  cost of unison per number of copies\n",
+                 kBlockSize, kNumShapes - 1);
+}
+
+int main(int argc, char ** argv) {
+    size_t blocks = 2000;
+    int only_shape = -1;
+    bool csv = false;
+    bool unison = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "b:s:cu")) != -1) {
+        switch (opt) {
+        case 'b':
+            blocks = std::atoi(optarg);
+            break;
+        case 's':
+            only_shape = std::atoi(optarg);
+            break;
+        case 'c':
+            csv = true;
+            break;
+        case 'u':
+            unison = true;
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+    if (blocks == 0 || only_shape >= kNumShapes) {
+        usage();
+        return 1;
+    }
+
+    static braids::MacroOscillator osc;
+    CycleCounter cycles;
+    const uint64_t overhead = now_ns_overhead();
+
+    if (unison) {
+        bench_unison(only_shape, blocks, csv, overhead, cycles);
+        return 0;
+    }
+
+    if (csv) {
+        std::printf("shape,name,note,timbre,color,ns_per_sample,cycles_per_sample,"
+                    "block_min_ns,block_median_ns,block_p99_ns\n");
+    } else {
+        std::printf("# %zu blocks of %zu samples per case, cycles from %s\n",
+                    blocks, kBlockSize, cycles.source() ? cycles.source() : "n/a");
+        std::printf("%-5s %-9s %4s %6s %6s %8s %8s %7s %7s %7s\n",
+                    "shape", "name", "note", "timbre", "color",
+                    "ns/smp", "cyc/smp", "min", "median", "p99");
+    }
+
+    for (int shape = 0; shape < kNumShapes; shape++) {
+        if (only_shape >= 0 && shape != only_shape) {
+            continue;
+        }
+        const char * name = unit_get_param_str_value(kShapeParam, shape);
+        for (uint8_t note : kNotes) {
+            for (const auto & tc : kTimbreColor) {
+                BenchResult r = bench_shape(osc, 1, shape, note, tc[0], tc[1],
+                                            blocks, overhead, cycles);
+                if (csv) {
+                    std::printf("%d,%s,%d,%d,%d,%.2f,%.1f,%llu,%llu,%llu\n",
+                                shape, name, note, tc[0], tc[1],
+                                r.ns_per_sample, cycles.source() ? r.cycles_per_sample : 0.,
+                                (unsigned long long)r.min,
+                                (unsigned long long)r.median,
+                                (unsigned long long)r.p99);
+                } else {
+                    std::printf("%-5d %-9s %4d %6d %6d %8.2f %8.1f %7llu %7llu %7llu\n",
+                                shape, name, note, tc[0], tc[1],
+                                r.ns_per_sample, cycles.source() ? r.cycles_per_sample : 0.,
+                                (unsigned long long)r.min,
+                                (unsigned long long)r.median,
+                                (unsigned long long)r.p99);
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+#pragma once
+/*
+ *  File: clock.h
+ *
+ *  time and cycle measurement for the host tools
+ *
+ */
+
+#include <cstdint>
+#include <cstring>
+
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "monotonic.h"
+
+// Cost of a now_ns() pair, to be subtracted from short measurements.
+inline uint64_t now_ns_overhead() {
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t t0 = now_ns();
+        uint64_t t1 = now_ns();
+        if (t1 - t0 < best) {
+            best = t1 - t0;
+        }
+    }
+    return best;
+}
+
+// Counts CPU cycles of the calling thread with the Linux perf interface,
+// falling back to the time stamp counter on x86. Reads are system calls,
+// so use it around long runs rather than single blocks.
+class CycleCounter {
+public:
+    CycleCounter(void) : fd_(-1) {
+#if defined(__linux__)
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    ~CycleCounter(void) {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    // "cycles", "tsc", or nullptr when cycles cannot be measured.
+    inline const char * source() const {
+        if (fd_ >= 0) {
+            return "cycles";
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        return "tsc";
+#else
+        return nullptr;
+#endif
+    }
+
+    inline uint64_t read() const {
+        uint64_t v = 0;
+        if (fd_ >= 0) {
+            if (::read(fd_, &v, sizeof(v)) != sizeof(v)) {
+                v = 0;
+            }
+            return v;
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        v = __rdtsc();
+#endif
+        return v;
+    }
+
+private:
+    int fd_;
+};
@@ -0,0 +1,65 @@
+#pragma once
+/*
+ *  File: fft.h
+ *
+ *  power spectrum for the host analysis tools
+ *
+ *  An in-place radix-2 complex FFT in double precision and a 4-term
+ *  Blackman-Harris window (sidelobes below -92 dB), enough to measure
+ *  aliasing well under the 16-bit noise floor. Not meant to be fast.
+ *
+ */
+
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+// size must be a power of 2
+inline void fft(std::vector<std::complex<double>> & x) {
+    const size_t n = x.size();
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap(x[i], x[j]);
+        }
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        const double a = -2 * M_PI / len;
+        const std::complex<double> w(std::cos(a), std::sin(a));
+        for (size_t i = 0; i < n; i += len) {
+            std::complex<double> wk(1, 0);
+            for (size_t k = 0; k < len / 2; k++) {
+                const std::complex<double> u = x[i + k];
+                const std::complex<double> v = x[i + k + len / 2] * wk;
+                x[i + k] = u + v;
+                x[i + k + len / 2] = u - v;
+                wk *= w;
+            }
+        }
+    }
+}
+
+inline double blackman_harris(size_t i, size_t n) {
+    const double t = 2 * M_PI * i / n;
+    return 0.35875 - 0.48829 * std::cos(t) + 0.14128 * std::cos(2 * t) - 0.01168 * std::cos(3 * t);
+}
+
+// Windowed power spectrum of a real signal, bins 0 to n/2.
+inline std::vector<double> power_spectrum(const std::vector<double> & signal) {
+    const size_t n = signal.size();
+    std::vector<std::complex<double>> x(n);
+    for (size_t i = 0; i < n; i++) {
+        x[i] = signal[i] * blackman_harris(i, n);
+    }
+    fft(x);
+    std::vector<double> power(n / 2 + 1);
+    for (size_t i = 0; i <= n / 2; i++) {
+        power[i] = std::norm(x[i]);
+    }
+    return power;
+}
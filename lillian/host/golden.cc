@@ -0,0 +1,303 @@
+/*
+ *  File: golden.cc
+ *
+ *  golden-output regression check
+ *
+ *  Renders every oscillator shape (int16 MacroOscillator output) and every
+ *  preset plus a few crusher/signature variants and a legato note pattern
+ *  (float unit_render output)
+ *  with a fixed random seed, and compares the result with the files stored
+ *  in the golden directory.
+ *
+ *  usage: golden [-d dir] [-t snr_db] [-u]
+ *
+ *  By default the output must be bit-exact. With -t, a case passes when its
+ *  signal-to-error ratio against the golden file is at least snr_db, for
+ *  changes that are intentionally not bit-exact. -u rewrites the golden
+ *  files from the current build.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "unit.h"
+#include "stmlib/utils/random.h"
+#include "braids/macro_oscillator.h"
+#include "unison.h"
+
+#include "script.h"
+#include "unit_host.h"
+
+constexpr uint32_t kSeed = 0x21;
+constexpr size_t kBlockSize = 24;  // size of temp_buffer in macro_oscillator.h
+constexpr size_t kOscBlocks = 100;
+constexpr int kNumShapes = 47;
+constexpr int kNumPresets = 9;
+
+static const uint8_t kOscNotes[] = { 36, 72 };
+static const int16_t kOscTimbreColor[][2] = {
+    { 0, 0 },
+    { 24576, 8192 },
+};
+
+// Parameters outside the presets' defaults, to cover the bit/rate reducer,
+// the signature waveshaper, the drum kit and unison.
+struct Variant {
+    const char * name;
+    uint8_t preset;
+    int param;
+    int32_t value;
+    int param2;  // -1: none
+    int32_t value2;
+};
+
+// The unison cases are skipped by builds with fewer copies than they ask
+// for (LILLIAN_UNISON in config.mk).
+constexpr uint8_t kUnisonParam = 34;
+static const Variant kVariants[] = {
+    { "bits2", 3, 22, 0, -1, 0 },       // Resolution: 2 bits
+    { "bits8", 5, 22, 4, -1, 0 },       // Resolution: 8 bits
+    { "rate4k", 0, 23, 0, -1, 0 },      // SampleRate: 4K
+    { "rate16k", 3, 23, 3, -1, 0 },     // SampleRate: 16K
+    { "signature", 1, 26, 4, -1, 0 },   // Signature: full
+    { "kit", 0, 33, 1, -1, 0 },         // Kit: PhazBass at 36 and Init at 45
+    { "unison", 0, 34, 4, 35, 20 },     // Unison: 4 copies of CS SAW, +-20 cents, sequential
+    { "unison_packed", 5, 34, 4, 35, 20 },  // Unison: 4 copies of Phz LPF, packed
+};
+
+// note pattern played for each float case
+static const Event kPattern[] = {
+    { 0, EV_NOTE_ON, 60, 100 },
+    { 9600, EV_NOTE_OFF, 60, 0 },
+    { 14400, EV_NOTE_ON, 67, 80 },
+    { 21600, EV_NOTE_OFF, 67, 0 },
+};
+constexpr uint64_t kPatternFrames = 28800;
+
+// legato: the second note is played while the first is held, so that with
+// one voice it strikes the sounding voice and must retrigger its envelopes
+static const Event kLegatoPattern[] = {
+    { 0, EV_NOTE_ON, 60, 100 },
+    { 9600, EV_NOTE_ON, 62, 100 },
+    { 19200, EV_NOTE_OFF, 62, 0 },
+    { 21600, EV_NOTE_OFF, 60, 0 },
+};
+
+struct Options {
+    std::string dir;
+    double snr_db;
+    bool update;
+};
+
+static bool read_file(const std::string & path, std::vector<uint8_t> & data) {
+    FILE * fp = std::fopen(path.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+    std::fseek(fp, 0, SEEK_END);
+    data.resize(std::ftell(fp));
+    std::fseek(fp, 0, SEEK_SET);
+    bool ok = std::fread(data.data(), 1, data.size(), fp) == data.size();
+    std::fclose(fp);
+    return ok;
+}
+
+static bool write_file(const std::string & path, const void * data, size_t size) {
+    FILE * fp = std::fopen(path.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    bool ok = std::fwrite(data, 1, size, fp) == size;
+    return std::fclose(fp) == 0 && ok;
+}
+
+// Signal-to-error ratio in dB of x against the reference.
+template <typename T>
+static double snr_db(const T * ref, const T * x, size_t n) {
+    double signal = 0;
+    double error = 0;
+    for (size_t i = 0; i < n; i++) {
+        const double r = ref[i];
+        const double e = static_cast<double>(x[i]) - r;
+        signal += r * r;
+        error += e * e;
+    }
+    if (error == 0) {
+        return INFINITY;
+    }
+    return signal == 0 ? -INFINITY : 10 * std::log10(signal / error);
+}
+
+// Compares a rendered case with its golden file, or writes it with -u.
+template <typename T>
+static bool check(const Options & opt, const std::string & name, const std::vector<T> & out) {
+    const std::string path = opt.dir + "/" + name + ".raw";
+    const size_t size = out.size() * sizeof(T);
+    if (opt.update) {
+        if (!write_file(path, out.data(), size)) {
+            std::printf("%-24s cannot write %s\n", name.c_str(), path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<uint8_t> golden;
+    if (!read_file(path, golden)) {
+        std::printf("%-24s FAIL: missing %s\n", name.c_str(), path.c_str());
+        return false;
+    }
+    if (golden.size() != size) {
+        std::printf("%-24s FAIL: length %zu, golden %zu\n", name.c_str(), size, golden.size());
+        return false;
+    }
+    if (std::memcmp(golden.data(), out.data(), size) == 0) {
+        return true;
+    }
+
+    const T * ref = reinterpret_cast<const T *>(golden.data());
+    size_t first = 0;
+    while (first < out.size() && ref[first] == out[first]) {
+        first++;
+    }
+    const double snr = snr_db(ref, out.data(), out.size());
+    const bool pass = opt.snr_db > 0 && snr >= opt.snr_db;
+    std::printf("%-24s %s: differs from sample %zu, SNR %.1f dB\n",
+                name.c_str(), pass ? "ok" : "FAIL", first, snr);
+    return pass;
+}
+
+static std::vector<int16_t> render_shape(int shape) {
+    static braids::MacroOscillator osc;
+    const uint8_t sync[kBlockSize] = {};
+    std::vector<int16_t> out;
+
+    for (uint8_t note : kOscNotes) {
+        for (const auto & tc : kOscTimbreColor) {
+            stmlib::Random::Seed(kSeed);
+            std::memset(&osc, 0, sizeof(osc));
+            osc.Init();
+            osc.set_shape(static_cast<braids::MacroOscillatorShape>(shape));
+            osc.set_pitch(note << 7);
+            osc.set_parameters(tc[0], tc[1]);
+            osc.Strike();
+            for (size_t i = 0; i < kOscBlocks; i++) {
+                int16_t buf[kBlockSize];
+                osc.Render(sync, buf, kBlockSize);
+                out.insert(out.end(), buf, buf + kBlockSize);
+            }
+        }
+    }
+    return out;
+}
+
+static std::vector<float> render_preset(uint8_t preset, int param, int32_t value,
+                                        int param2 = -1, int32_t value2 = 0,
+                                        const Event * pattern = kPattern,
+                                        size_t num_events = sizeof(kPattern) / sizeof(kPattern[0])) {
+    std::vector<float> out(kPatternFrames * 2);
+
+    host_unit_init(kHostDefaultFrames);
+    unit_reset();
+    unit_load_preset(preset);
+    if (param >= 0) {
+        unit_set_param_value(param, value);
+    }
+    if (param2 >= 0) {
+        unit_set_param_value(param2, value2);
+    }
+    // the instance starts its noise from kRandomSeed in unit_init
+
+    size_t next = 0;
+    for (uint64_t pos = 0; pos < kPatternFrames; pos += kHostDefaultFrames) {
+        uint32_t n = std::min<uint64_t>(kHostDefaultFrames, kPatternFrames - pos);
+        while (next < num_events && pattern[next].frame < pos + n) {
+            dispatch_event(pattern[next++]);
+        }
+        unit_render(nullptr, &out[pos * 2], n);
+    }
+    return out;
+}
+
+static void usage() {
+    std::fprintf(stderr,
+                 "usage: golden [-d dir] [-t snr_db] [-u]\n"
+                 "  -d  golden file directory (default: golden)\n"
+                 "  -t  accept non bit-exact output with at least this SNR\n"
+                 "  -u  update the golden files\n");
+}
+
+int main(int argc, char ** argv) {
+    Options opt = { "golden", 0, false };
+
+    int c;
+    while ((c = getopt(argc, argv, "d:t:u")) != -1) {
+        switch (c) {
+        case 'd':
+            opt.dir = optarg;
+            break;
+        case 't':
+            opt.snr_db = std::atof(optarg);
+            break;
+        case 'u':
+            opt.update = true;
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+
+    if (!opt.update && access(opt.dir.c_str(), F_OK) != 0) {
+        std::printf("%s: no golden files. Render them with make update-golden on the\n"
+                    "baseline revision, with the eurorack submodule checked out (README).\n",
+                    opt.dir.c_str());
+        return 2;
+    }
+
+    int failed = 0;
+    int total = 0;
+    char name[32];
+
+    // Every case starts from a fresh oscillator or unit_init and from the
+    // fixed seed, so the cases do not depend on each other or their order.
+    for (int shape = 0; shape < kNumShapes; shape++) {
+        std::snprintf(name, sizeof(name), "osc_%02d", shape);
+        failed += !check(opt, name, render_shape(shape));
+        total++;
+    }
+    for (int preset = 0; preset < kNumPresets; preset++) {
+        std::snprintf(name, sizeof(name), "preset_%d", preset);
+        failed += !check(opt, name, render_preset(preset, -1, 0));
+        total++;
+    }
+    for (const Variant & v : kVariants) {
+        std::snprintf(name, sizeof(name), "preset_%d_%s", v.preset, v.name);
+        if (v.param == kUnisonParam
+            && static_cast<size_t>(v.value) > UnisonOscillator::kMaxUnison) {
+            std::printf("%-24s skipped: LILLIAN_UNISON is %zu\n", name,
+                        UnisonOscillator::kMaxUnison);
+            continue;
+        }
+        failed += !check(opt, name, render_preset(v.preset, v.param, v.value, v.param2, v.value2));
+        total++;
+    }
+    const size_t num_legato = sizeof(kLegatoPattern) / sizeof(kLegatoPattern[0]);
+    failed += !check(opt, "preset_0_legato", render_preset(0, -1, 0, -1, 0, kLegatoPattern, num_legato));
+    total++;
+
+    if (opt.update) {
+        std::printf("%s: %d golden files written\n", opt.dir.c_str(), total - failed);
+    } else {
+        std::printf("%d/%d cases passed\n", total - failed, total);
+    }
+    return failed ? 1 : 0;
+}
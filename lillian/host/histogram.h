@@ -0,0 +1,116 @@
+#pragma once
+/*
+ *  File: histogram.h
+ *
+ *  log-bucketed histogram of durations in nanoseconds
+ *
+ *  Each octave is split into 8 buckets, so a value is known within 12.5%
+ *  from 8 ns up to about 18 minutes, with constant memory and O(1) adds.
+ *
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+class LogHistogram {
+public:
+    static constexpr int kSubBits = 3;
+    static constexpr int kSubBuckets = 1 << kSubBits;
+    static constexpr int kMaxBits = 40;
+    static constexpr int kNumBuckets = (kMaxBits - kSubBits + 2) * kSubBuckets;
+
+    LogHistogram(void) { Clear(); }
+
+    void Clear() {
+        std::memset(buckets_, 0, sizeof(buckets_));
+        count_ = 0;
+        max_ = 0;
+    }
+
+    inline void Add(uint64_t v) {
+        buckets_[index(v)]++;
+        count_++;
+        if (v > max_) {
+            max_ = v;
+        }
+    }
+
+    inline uint64_t count() const {
+        return count_;
+    }
+
+    inline uint64_t max() const {
+        return max_;
+    }
+
+    // Upper edge of the bucket holding the p-quantile (0 < p <= 1),
+    // never more than the largest value seen.
+    uint64_t Percentile(double p) const {
+        if (count_ == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(p * count_ + 0.5);
+        if (rank < 1) {
+            rank = 1;
+        }
+        uint64_t seen = 0;
+        for (int i = 0; i < kNumBuckets; i++) {
+            seen += buckets_[i];
+            if (seen >= rank) {
+                uint64_t upper = lower(i + 1) - 1;
+                return upper < max_ ? upper : max_;
+            }
+        }
+        return max_;
+    }
+
+    // Prints the non-empty buckets, marking the first one above limit.
+    void Print(FILE * fp, uint64_t limit) const {
+        uint64_t seen = 0;
+        bool marked = false;
+        for (int i = 0; i < kNumBuckets; i++) {
+            if (!buckets_[i]) {
+                continue;
+            }
+            if (!marked && lower(i) > limit) {
+                std::fprintf(fp, "  ---- deadline %.1f us ----\n", limit / 1000.);
+                marked = true;
+            }
+            seen += buckets_[i];
+            std::fprintf(fp, "  %9.2f us  %10llu  %7.3f%%  ",
+                         lower(i) / 1000., (unsigned long long)buckets_[i],
+                         100. * seen / count_);
+            int bar = static_cast<int>(50. * buckets_[i] / count_ + 0.5);
+            for (int j = 0; j < bar; j++) {
+                std::fputc('#', fp);
+            }
+            std::fputc('\n', fp);
+        }
+    }
+
+private:
+    static inline int index(uint64_t v) {
+        if (v < kSubBuckets) {
+            return v;
+        }
+        int msb = 63 - __builtin_clzll(v);
+        if (msb > kMaxBits) {
+            return kNumBuckets - 1;
+        }
+        return (msb - kSubBits + 1) * kSubBuckets + ((v >> (msb - kSubBits)) & (kSubBuckets - 1));
+    }
+
+    // smallest value falling in bucket i
+    static inline uint64_t lower(int i) {
+        if (i < kSubBuckets) {
+            return i;
+        }
+        int msb = i / kSubBuckets + kSubBits - 1;
+        return static_cast<uint64_t>(kSubBuckets + i % kSubBuckets) << (msb - kSubBits);
+    }
+
+    uint64_t buckets_[kNumBuckets];
+    uint64_t count_;
+    uint64_t max_;
+};
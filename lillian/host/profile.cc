@@ -0,0 +1,261 @@
+/*
+ *  File: profile.cc
+ *
+ *  worst-case render time profiler
+ *
+ *  Plays an event script like render does, timing every unit_render call.
+ *  Each call is tagged with the shape and preset in effect and with the
+ *  kinds of events dispatched just before it, and the durations are
+ *  reported against the realtime deadline of one buffer at 48 kHz.
+ *
+ *  usage: profile [-f frames] [-l seconds] [-n loops] [-w worst] script
+ *
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <unistd.h>
+
+#include "unit.h"
+#include "unit_host.h"
+#include "clock.h"
+#include "histogram.h"
+#include "render_stats.h"
+#include "unit_ext.h"
+#include "script.h"
+
+constexpr uint8_t kShapeParam = 1;
+constexpr uint8_t kCpuLoadParam = 32;  // hidden, see Params in synth.h
+constexpr int kNumShapes = 47;
+
+// what happened right before a callback
+enum Tag {
+    TAG_NONE,
+    TAG_NOTE_ON,
+    TAG_NOTE_OFF,
+    TAG_PARAM,
+    TAG_SHAPE,
+    TAG_PRESET,
+    NUM_TAGS
+};
+
+static const char * const kTagStr[NUM_TAGS] = {
+    "none", "note on", "note off", "param", "shape", "preset",
+};
+
+struct Callback {
+    uint64_t frame;
+    uint64_t ns;
+    uint8_t shape;
+    uint8_t preset;
+    uint8_t tags;
+};
+
+static uint8_t event_tag(const Event & e) {
+    switch (e.type) {
+    case EV_NOTE_ON:
+    case EV_GATE_ON:
+        return 1 << TAG_NOTE_ON;
+    case EV_NOTE_OFF:
+    case EV_GATE_OFF:
+    case EV_ALL_NOTE_OFF:
+        return 1 << TAG_NOTE_OFF;
+    case EV_PARAM:
+        return 1 << (e.a == kShapeParam ? TAG_SHAPE : TAG_PARAM);
+    case EV_PRESET:
+        return 1 << TAG_PRESET;
+    }
+    return 0;
+}
+
+static void print_row(const char * name, const LogHistogram & h,
+                      uint64_t misses, uint64_t deadline) {
+    if (!h.count()) {
+        return;
+    }
+    std::printf("  %-9s %8llu %8.1f %8.1f %8.1f %8.1f %7.1f%% %6llu\n", name,
+                (unsigned long long)h.count(),
+                h.Percentile(0.5) / 1000., h.Percentile(0.99) / 1000.,
+                h.Percentile(0.999) / 1000., h.max() / 1000.,
+                100. * h.max() / deadline, (unsigned long long)misses);
+}
+
+static void print_header(const char * what) {
+    std::printf("  %-9s %8s %8s %8s %8s %8s %8s %6s\n",
+                what, "calls", "p50 us", "p99 us", "p99.9 us", "max us", "max/dl", "misses");
+}
+
+static void usage() {
+    std::fprintf(stderr,
+                 "usage: profile [-f frames] [-l seconds] [-n loops] [-w worst] script\n"
+                 "  -f  frames per unit_render call (default %d)\n"
+                 "  -l  pattern length, default: last event + 1s\n"
+                 "  -n  number of times the pattern is played (default 1)\n"
+                 "  -w  number of slowest callbacks listed (default 10)\n",
+                 kHostDefaultFrames);
+}
+
+int main(int argc, char ** argv) {
+    uint16_t frames = kHostDefaultFrames;
+    double length = 0;
+    uint32_t loops = 1;
+    size_t num_worst = 10;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:l:n:w:")) != -1) {
+        switch (opt) {
+        case 'f':
+            frames = std::atoi(optarg);
+            break;
+        case 'l':
+            length = std::atof(optarg);
+            break;
+        case 'n':
+            loops = std::atoi(optarg);
+            break;
+        case 'w':
+            num_worst = std::atoi(optarg);
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+    if (optind != argc - 1 || frames == 0 || loops == 0) {
+        usage();
+        return 1;
+    }
+
+    Script script;
+    if (!script.Load(argv[optind])) {
+        return 1;
+    }
+    uint64_t pattern_frames = length > 0
+        ? static_cast<uint64_t>(length * kHostSampleRate)
+        : script.lastFrame() + kHostSampleRate;
+
+    int8_t err = host_unit_init(frames);
+    if (err != k_unit_err_none) {
+        std::fprintf(stderr, "unit_init failed: %d\n", err);
+        return 1;
+    }
+
+    const uint64_t deadline = static_cast<uint64_t>(frames) * 1000000000u / kHostSampleRate;
+    const uint64_t overhead = now_ns_overhead();
+    std::vector<float> out(frames * 2);
+    const std::vector<Event> & events = script.events();
+
+    LogHistogram all;
+    LogHistogram by_shape[kNumShapes];
+    LogHistogram by_tag[NUM_TAGS];
+    uint64_t misses = 0;
+    uint64_t shape_misses[kNumShapes] = {};
+    uint64_t tag_misses[NUM_TAGS] = {};
+    int32_t peak_load = 0;
+    std::vector<Callback> worst;
+
+    for (uint32_t loop = 0; loop < loops; loop++) {
+        size_t next = 0;
+        for (uint64_t pos = 0; pos < pattern_frames; pos += frames) {
+            uint32_t n = std::min<uint64_t>(frames, pattern_frames - pos);
+            Callback cb = {};
+            cb.frame = loop * pattern_frames + pos;
+            while (next < events.size() && events[next].frame < pos + n) {
+                cb.tags |= event_tag(events[next]);
+                dispatch_event(events[next], events[next].frame - pos);
+                next++;
+            }
+            cb.shape = unit_get_param_value(kShapeParam);
+            cb.preset = unit_get_preset_index();
+
+            const uint64_t t0 = now_ns();
+            unit_render(nullptr, out.data(), n);
+            const uint64_t t = now_ns() - t0;
+            cb.ns = t > overhead ? t - overhead : 0;
+            peak_load = std::max(peak_load, unit_get_param_value(kCpuLoadParam));
+
+            const bool miss = cb.ns > deadline;
+            all.Add(cb.ns);
+            misses += miss;
+            if (cb.shape < kNumShapes) {
+                by_shape[cb.shape].Add(cb.ns);
+                shape_misses[cb.shape] += miss;
+            }
+            for (int tag = 0; tag < NUM_TAGS; tag++) {
+                if ((cb.tags & (1 << tag)) || (tag == TAG_NONE && !cb.tags)) {
+                    by_tag[tag].Add(cb.ns);
+                    tag_misses[tag] += miss;
+                }
+            }
+
+            if (worst.size() < num_worst || cb.ns > worst.back().ns) {
+                auto it = std::upper_bound(worst.begin(), worst.end(), cb,
+                    [](const Callback & x, const Callback & y) { return x.ns > y.ns; });
+                worst.insert(it, cb);
+                if (worst.size() > num_worst) {
+                    worst.pop_back();
+                }
+            }
+        }
+    }
+
+    std::printf("%llu callbacks of %u frames, deadline %.1f us\n",
+                (unsigned long long)all.count(), frames, deadline / 1000.);
+    std::printf("deadline misses: %llu (%.4f%%)\n",
+                (unsigned long long)misses, 100. * misses / all.count());
+    std::printf("governor load: %d%% peak, %d%% at the end\n\n",
+                peak_load, unit_get_param_value(kCpuLoadParam));
+
+    print_header("");
+    print_row("all", all, misses, deadline);
+
+    std::printf("\nby shape in effect:\n");
+    print_header("shape");
+    for (int shape = 0; shape < kNumShapes; shape++) {
+        print_row(unit_get_param_str_value(kShapeParam, shape),
+                  by_shape[shape], shape_misses[shape], deadline);
+    }
+
+    std::printf("\nby preceding event:\n");
+    print_header("event");
+    for (int tag = 0; tag < NUM_TAGS; tag++) {
+        print_row(kTagStr[tag], by_tag[tag], tag_misses[tag], deadline);
+    }
+
+    std::printf("\nslowest callbacks:\n");
+    std::printf("  %10s %9s %-9s %6s  %s\n", "time s", "us", "shape", "preset", "events");
+    for (const Callback & cb : worst) {
+        std::printf("  %10.4f %9.1f %-9s %6d  ",
+                    static_cast<double>(cb.frame) / kHostSampleRate, cb.ns / 1000.,
+                    unit_get_param_str_value(kShapeParam, cb.shape), cb.preset);
+        for (int tag = 1; tag < NUM_TAGS; tag++) {
+            if (cb.tags & (1 << tag)) {
+                std::printf("%s ", kTagStr[tag]);
+            }
+        }
+        std::printf("\n");
+    }
+
+#ifdef LILLIAN_RENDER_STATS
+    RenderStatsSnapshot stats;
+    unit_get_render_stats(&stats);
+    uint64_t stats_total = 0;
+    for (int stage = 0; stage < NUM_RENDER_STAGES; stage++) {
+        stats_total += stats.ns[stage];
+    }
+    std::printf("\ntime per stage (%llu control blocks):\n", (unsigned long long)stats.blocks);
+    for (int stage = 0; stage < NUM_RENDER_STAGES; stage++) {
+        std::printf("  %-10s %8.2f ns/sample %6.1f%%\n", renderStageName(stage),
+                    static_cast<double>(stats.ns[stage]) / stats.frames,
+                    100. * stats.ns[stage] / stats_total);
+    }
+#endif
+
+    std::printf("\nhistogram:\n");
+    all.Print(stdout, deadline);
+    return 0;
+}
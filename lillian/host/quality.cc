@@ -0,0 +1,246 @@
+/*
+ *  File: quality.cc
+ *
+ *  aliasing vs cost of each oscillator shape
+ *
+ *  Renders every MacroOscillator shape across the pitch range and splits
+ *  the spectrum of the output into the harmonics of the played note and
+ *  everything else, which for the harmonic shapes is aliasing (plus
+ *  quantization noise). Reports the SNR, the strongest non-harmonic
+ *  component (SFDR) and the cycles/sample of the same render, so that the
+ *  cost of band-limiting can be weighed against what it buys.
+ *
+ *  For noise, filtered-noise and inharmonic shapes (bells, drums, particle
+ *  noise...) the "noise" part is mostly intended content and the figures
+ *  only compare renders of the same shape.
+ *
+ *  usage: quality [-s shape] [-t timbre] [-k color] [-c]
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <unistd.h>
+
+#include "unit.h"
+#include "stmlib/utils/random.h"
+#include "braids/macro_oscillator.h"
+
+#include "clock.h"
+#include "fft.h"
+
+constexpr double kSampleRate = 48000;
+constexpr size_t kBlockSize = 24;  // size of temp_buffer in macro_oscillator.h
+constexpr size_t kWarmupBlocks = 256;
+constexpr size_t kFftSize = 16384;
+constexpr size_t kMainLobe = 4;    // half width of the Blackman-Harris main lobe in bins
+constexpr double kMaxDetune = 0.005;
+constexpr uint8_t kShapeParam = 1;
+constexpr int kNumShapes = 47;  // range of the Shape parameter
+
+static const uint8_t kNotes[] = { 36, 48, 60, 72, 84, 96, 108 };
+
+struct Quality {
+    double cycles_per_sample;
+    double snr_db;
+    double sfdr_db;
+    double f0;
+};
+
+static inline double to_db(double ratio) {
+    return 10 * std::log10(std::max(ratio, 1e-30));
+}
+
+// Energy in the bins within kMainLobe of each harmonic of f0, DC excluded.
+static double harmonic_energy(const std::vector<double> & power, double f0,
+                              std::vector<bool> * mask) {
+    const double bin_hz = kSampleRate / kFftSize;
+    const size_t last = power.size() - 1;
+    double energy = 0;
+    for (double f = f0; f < kSampleRate / 2; f += f0) {
+        const size_t center = static_cast<size_t>(f / bin_hz + 0.5);
+        const size_t lo = center > kMainLobe ? center - kMainLobe : 1;
+        const size_t hi = std::min(center + kMainLobe, last);
+        for (size_t i = lo; i <= hi; i++) {
+            if (mask) {
+                if ((*mask)[i]) {
+                    continue;
+                }
+                (*mask)[i] = true;
+            }
+            energy += power[i];
+        }
+    }
+    return energy;
+}
+
+static Quality analyze(braids::MacroOscillator & osc, uint8_t shape, uint8_t note,
+                       int16_t timbre, int16_t color, const CycleCounter & cycles) {
+    int16_t buf[kBlockSize];
+    const uint8_t sync[kBlockSize] = {};
+
+    stmlib::Random::Seed(0x21);
+    std::memset(&osc, 0, sizeof(osc));
+    osc.Init();
+    osc.set_shape(static_cast<braids::MacroOscillatorShape>(shape));
+    osc.set_pitch(note << 7);
+    osc.set_parameters(timbre, color);
+    osc.Strike();
+    for (size_t i = 0; i < kWarmupBlocks; i++) {
+        osc.Render(sync, buf, kBlockSize);
+    }
+
+    // The whole render is timed once: counter reads are system calls, and
+    // around every block they would cost more than the block itself.
+    const size_t num_blocks = (kFftSize + kBlockSize - 1) / kBlockSize;
+    std::vector<int16_t> rendered(num_blocks * kBlockSize);
+    const uint64_t c0 = cycles.read();
+    for (size_t b = 0; b < num_blocks; b++) {
+        osc.Render(sync, &rendered[b * kBlockSize], kBlockSize);
+    }
+    const uint64_t c = cycles.read() - c0;
+    std::vector<double> signal(kFftSize);
+    for (size_t i = 0; i < kFftSize; i++) {
+        signal[i] = rendered[i] / 32768.;
+    }
+
+    Quality q;
+    q.cycles_per_sample = static_cast<double>(c) / rendered.size();
+
+    const std::vector<double> power = power_spectrum(signal);
+    double total = 0;
+    for (size_t i = kMainLobe + 1; i < power.size(); i++) {
+        total += power[i];
+    }
+
+    // The tuning tables are not exact, and at high harmonics a small pitch
+    // error moves them by several bins: search for the best matching f0.
+    const double nominal = 440 * std::pow(2, (note - 69) / 12.);
+    double best = -1;
+    q.f0 = nominal;
+    for (double d = -kMaxDetune; d <= kMaxDetune; d += kMaxDetune / 100) {
+        const double e = harmonic_energy(power, nominal * (1 + d), nullptr);
+        if (e > best) {
+            best = e;
+            q.f0 = nominal * (1 + d);
+        }
+    }
+
+    std::vector<bool> harmonic(power.size(), false);
+    for (size_t i = 0; i <= kMainLobe; i++) {
+        harmonic[i] = true;
+    }
+    const double signal_energy = harmonic_energy(power, q.f0, &harmonic);
+    double peak_harmonic = 0;
+    double peak_other = 0;
+    for (size_t i = kMainLobe + 1; i < power.size(); i++) {
+        if (harmonic[i]) {
+            peak_harmonic = std::max(peak_harmonic, power[i]);
+        } else {
+            peak_other = std::max(peak_other, power[i]);
+        }
+    }
+    q.snr_db = to_db(signal_energy / (total - signal_energy));
+    q.sfdr_db = to_db(peak_harmonic / peak_other);
+    return q;
+}
+
+static void print_bar(double value, double full_scale, int width) {
+    int n = static_cast<int>(width * std::max(0., value) / full_scale + 0.5);
+    for (int i = 0; i < std::min(n, width); i++) {
+        std::putchar('#');
+    }
+}
+
+static void usage() {
+    std::fprintf(stderr,
+                 "usage: quality [-s shape] [-t timbre] [-k color] [-c]\n"
+                 "  -s  analyze a single shape (0..%d)\n"
+                 "  -t  timbre (default 16384)\n"
+                 "  -k  color (default 16384)\n"
+                 "  -c  CSV output, one row per shape and note\n",
+                 kNumShapes - 1);
+}
+
+int main(int argc, char ** argv) {
+    int only_shape = -1;
+    int16_t timbre = 16384;
+    int16_t color = 16384;
+    bool csv = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:t:k:c")) != -1) {
+        switch (opt) {
+        case 's':
+            only_shape = std::atoi(optarg);
+            break;
+        case 't':
+            timbre = std::atoi(optarg);
+            break;
+        case 'k':
+            color = std::atoi(optarg);
+            break;
+        case 'c':
+            csv = true;
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+    if (only_shape >= kNumShapes) {
+        usage();
+        return 1;
+    }
+
+    static braids::MacroOscillator osc;
+    CycleCounter cycles;
+
+    if (csv) {
+        std::printf("shape,name,note,f0,cycles_per_sample,snr_db,sfdr_db\n");
+    } else {
+        std::printf("# %zu-point FFT at %.0f Hz, notes %d..%d, timbre %d color %d, cycles from %s\n",
+                    kFftSize, kSampleRate, kNotes[0], kNotes[sizeof(kNotes) - 1],
+                    timbre, color, cycles.source() ? cycles.source() : "n/a");
+        std::printf("%-5s %-9s %8s %8s %8s %9s  %s\n",
+                    "shape", "name", "cyc/smp", "min SNR", "mean SNR", "min SFDR",
+                    "worst SNR (10 dB per #)");
+    }
+
+    for (int shape = 0; shape < kNumShapes; shape++) {
+        if (only_shape >= 0 && shape != only_shape) {
+            continue;
+        }
+        const char * name = unit_get_param_str_value(kShapeParam, shape);
+        double cost = 0;
+        double min_snr = 1e9;
+        double mean_snr = 0;
+        double min_sfdr = 1e9;
+        for (uint8_t note : kNotes) {
+            const Quality q = analyze(osc, shape, note, timbre, color, cycles);
+            if (csv) {
+                std::printf("%d,%s,%d,%.2f,%.1f,%.1f,%.1f\n", shape, name, note, q.f0,
+                            cycles.source() ? q.cycles_per_sample : 0., q.snr_db, q.sfdr_db);
+            }
+            cost += q.cycles_per_sample;
+            min_snr = std::min(min_snr, q.snr_db);
+            mean_snr += q.snr_db;
+            min_sfdr = std::min(min_sfdr, q.sfdr_db);
+        }
+        if (!csv) {
+            const size_t num_notes = sizeof(kNotes);
+            std::printf("%-5d %-9s %8.1f %8.1f %8.1f %9.1f  ", shape, name,
+                        cycles.source() ? cost / num_notes : 0.,
+                        min_snr, mean_snr / num_notes, min_sfdr);
+            print_bar(min_snr, 10, 12);
+            std::printf("\n");
+        }
+    }
+    return 0;
+}
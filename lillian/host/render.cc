@@ -0,0 +1,121 @@
+/*
+ *  File: render.cc
+ *
+ *  offline renderer: plays an event script through the unit callbacks
+ *  and writes the output to a WAV file as fast as possible
+ *
+ *  usage: render [-f frames] [-l seconds] [-n loops] [-o out.wav] script
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <unistd.h>
+
+#include "unit.h"
+#include "unit_host.h"
+#include "script.h"
+#include "wav.h"
+
+static void usage() {
+    std::fprintf(stderr,
+                 "usage: render [-f frames] [-l seconds] [-n loops] [-o out.wav] script\n"
+                 "  -f  frames per unit_render call (default %d)\n"
+                 "  -l  pattern length, default: last event + 1s\n"
+                 "  -n  number of times the pattern is played (default 1)\n"
+                 "  -o  output file; nothing is written when omitted\n",
+                 kHostDefaultFrames);
+}
+
+int main(int argc, char ** argv) {
+    uint16_t frames = kHostDefaultFrames;
+    double length = 0;
+    uint32_t loops = 1;
+    const char * out_path = nullptr;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:l:n:o:")) != -1) {
+        switch (opt) {
+        case 'f':
+            frames = std::atoi(optarg);
+            break;
+        case 'l':
+            length = std::atof(optarg);
+            break;
+        case 'n':
+            loops = std::atoi(optarg);
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+    if (optind != argc - 1 || frames == 0 || loops == 0) {
+        usage();
+        return 1;
+    }
+
+    Script script;
+    if (!script.Load(argv[optind])) {
+        return 1;
+    }
+
+    uint64_t pattern_frames = length > 0
+        ? static_cast<uint64_t>(length * kHostSampleRate)
+        : script.lastFrame() + kHostSampleRate;
+
+    int8_t err = host_unit_init(frames);
+    if (err != k_unit_err_none) {
+        std::fprintf(stderr, "unit_init failed: %d\n", err);
+        return 1;
+    }
+
+    WavWriter wav;
+    if (out_path && !wav.Open(out_path, kHostSampleRate, 2)) {
+        std::fprintf(stderr, "%s: cannot open\n", out_path);
+        return 1;
+    }
+
+    using clock = std::chrono::steady_clock;
+    std::vector<float> out(frames * 2);
+    const std::vector<Event> & events = script.events();
+    clock::duration render_time(0);
+    const clock::time_point start = clock::now();
+
+    for (uint32_t loop = 0; loop < loops; loop++) {
+        size_t next = 0;
+        for (uint64_t pos = 0; pos < pattern_frames; pos += frames) {
+            uint32_t n = std::min<uint64_t>(frames, pattern_frames - pos);
+            // notes and gates land on their frame within the buffer
+            while (next < events.size() && events[next].frame < pos + n) {
+                dispatch_event(events[next], events[next].frame - pos);
+                next++;
+            }
+            const clock::time_point t0 = clock::now();
+            unit_render(nullptr, out.data(), n);
+            render_time += clock::now() - t0;
+            if (wav.isOpen()) {
+                wav.Write(out.data(), n);
+            }
+        }
+    }
+    wav.Close();
+
+    const double audio_sec = static_cast<double>(pattern_frames) * loops / kHostSampleRate;
+    const double render_sec = std::chrono::duration<double>(render_time).count();
+    const double total_sec = std::chrono::duration<double>(clock::now() - start).count();
+    std::fprintf(stderr, "rendered %.2f s of audio\n", audio_sec);
+    std::fprintf(stderr, "unit_render: %.3f s (%.1fx realtime)\n",
+                 render_sec, audio_sec / render_sec);
+    std::fprintf(stderr, "total:       %.3f s (%.1fx realtime)\n",
+                 total_sec, audio_sec / total_sec);
+    return 0;
+}
@@ -0,0 +1,180 @@
+#pragma once
+/*
+ *  File: script.h
+ *
+ *  timed event scripts for the host tools
+ *
+ *  One event per line, '#' starts a comment:
+ *
+ *    <time> note_on <note> <velocity>
+ *    <time> note_off <note>
+ *    <time> gate_on <velocity>
+ *    <time> gate_off
+ *    <time> all_off
+ *    <time> param <id|name> <value>
+ *    <time> preset <index>
+ *
+ *  <time> is in seconds, or in milliseconds with an "ms" suffix.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "unit.h"
+#include "unit_ext.h"
+#include "unit_host.h"
+
+enum EventType {
+    EV_NOTE_ON,
+    EV_NOTE_OFF,
+    EV_GATE_ON,
+    EV_GATE_OFF,
+    EV_ALL_NOTE_OFF,
+    EV_PARAM,
+    EV_PRESET,
+};
+
+struct Event {
+    uint64_t frame;
+    EventType type;
+    int32_t a;
+    int32_t b;
+};
+
+// offset: frames from the start of the next unit_render call at which a
+// note or gate lands
+inline void dispatch_event(const Event & e, uint32_t offset = 0) {
+    unit_set_event_offset(offset);
+    switch (e.type) {
+    case EV_NOTE_ON:
+        unit_note_on(e.a, e.b);
+        break;
+    case EV_NOTE_OFF:
+        unit_note_off(e.a);
+        break;
+    case EV_GATE_ON:
+        unit_gate_on(e.a);
+        break;
+    case EV_GATE_OFF:
+        unit_gate_off();
+        break;
+    case EV_ALL_NOTE_OFF:
+        unit_all_note_off();
+        break;
+    case EV_PARAM:
+        unit_set_param_value(e.a, e.b);
+        break;
+    case EV_PRESET:
+        unit_load_preset(e.a);
+        break;
+    }
+}
+
+class Script {
+public:
+    // Parses a script; errors are reported on stderr with the line number.
+    bool Load(const char * path) {
+        FILE * fp = std::strcmp(path, "-") ? std::fopen(path, "r") : stdin;
+        if (!fp) {
+            std::fprintf(stderr, "%s: cannot open\n", path);
+            return false;
+        }
+        char line[256];
+        bool ok = true;
+        for (int lineno = 1; ok && std::fgets(line, sizeof(line), fp); lineno++) {
+            char * hash = std::strchr(line, '#');
+            if (hash) {
+                *hash = '\0';
+            }
+            ok = parseLine(line);
+            if (!ok) {
+                std::fprintf(stderr, "%s:%d: invalid event\n", path, lineno);
+            }
+        }
+        if (fp != stdin) {
+            std::fclose(fp);
+        }
+        std::stable_sort(events_.begin(), events_.end(),
+                         [](const Event & x, const Event & y) { return x.frame < y.frame; });
+        return ok;
+    }
+
+    inline const std::vector<Event> & events() const {
+        return events_;
+    }
+
+    inline uint64_t lastFrame() const {
+        return events_.empty() ? 0 : events_.back().frame;
+    }
+
+private:
+    bool parseLine(char * line) {
+        const char * tok[4] = {};
+        int n = 0;
+        for (char * t = std::strtok(line, " \t\r\n"); t; t = std::strtok(nullptr, " \t\r\n")) {
+            if (n == 4) {
+                return false;
+            }
+            tok[n++] = t;
+        }
+        if (n == 0) {
+            return true;
+        }
+        if (n < 2) {
+            return false;
+        }
+
+        char * end;
+        double t = std::strtod(tok[0], &end);
+        if (std::strcmp(end, "ms") == 0) {
+            t /= 1000;
+        } else if (*end != '\0') {
+            return false;
+        }
+        if (t < 0) {
+            return false;
+        }
+
+        Event e = {};
+        e.frame = static_cast<uint64_t>(std::llround(t * kHostSampleRate));
+        const char * cmd = tok[1];
+        int args = n - 2;
+        if (!std::strcmp(cmd, "note_on") && args == 2) {
+            e.type = EV_NOTE_ON;
+            e.a = std::atoi(tok[2]);
+            e.b = std::atoi(tok[3]);
+        } else if (!std::strcmp(cmd, "note_off") && args == 1) {
+            e.type = EV_NOTE_OFF;
+            e.a = std::atoi(tok[2]);
+        } else if (!std::strcmp(cmd, "gate_on") && args == 1) {
+            e.type = EV_GATE_ON;
+            e.a = std::atoi(tok[2]);
+        } else if (!std::strcmp(cmd, "gate_off") && args == 0) {
+            e.type = EV_GATE_OFF;
+        } else if (!std::strcmp(cmd, "all_off") && args == 0) {
+            e.type = EV_ALL_NOTE_OFF;
+        } else if (!std::strcmp(cmd, "param") && args == 2) {
+            e.type = EV_PARAM;
+            e.a = host_param_id(tok[2]);
+            e.b = std::atoi(tok[3]);
+            if (e.a < 0) {
+                return false;
+            }
+        } else if (!std::strcmp(cmd, "preset") && args == 1) {
+            e.type = EV_PRESET;
+            e.a = std::atoi(tok[2]);
+        } else {
+            return false;
+        }
+        events_.push_back(e);
+        return true;
+    }
+
+    std::vector<Event> events_;
+};
@@ -0,0 +1,11 @@
+#pragma once
+/*
+ *  File: attributes.h
+ *
+ *  Host stand-in for the drumlogue SDK common/attributes.h
+ *
+ */
+
+#define fast_inline inline __attribute__((always_inline, optimize("Ofast")))
+#define __unit_header __attribute__((used, section(".unit_header")))
+#define __unit_callback __attribute__((used))
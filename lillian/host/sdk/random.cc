@@ -0,0 +1,14 @@
+/*
+ *  File: random.cc
+ *
+ *  Host stand-in for stmlib/utils/random.cc, see stmlib/utils/random.h
+ *
+ */
+
+#include "stmlib/utils/random.h"
+
+namespace stmlib {
+
+thread_local uint32_t Random::rng_state_ = 0x21;
+
+}  // namespace stmlib
@@ -0,0 +1,79 @@
+#pragma once
+/*
+ *  File: runtime.h
+ *
+ *  Host stand-in for the drumlogue SDK common/runtime.h
+ *
+ *  Only the definitions used by the unit sources are provided; sample
+ *  banks are not available on the host.
+ *
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+    k_unit_module_global = 0U,
+    k_unit_module_modfx,
+    k_unit_module_delfx,
+    k_unit_module_revfx,
+    k_unit_module_synth,
+    k_unit_module_masterfx,
+    k_num_unit_modules,
+};
+
+enum {
+    k_unit_target_drumlogue = (4U << 8),
+    k_unit_target_platform_mask = (0x7FU << 8),
+    k_unit_target_module_mask = (0x7FU),
+};
+
+enum {
+    k_unit_err_none = 0,
+    k_unit_err_target = -1,
+    k_unit_err_api_version = -2,
+    k_unit_err_samplerate = -4,
+    k_unit_err_geometry = -8,
+    k_unit_err_memory = -16,
+    k_unit_err_undef = -32,
+};
+
+enum {
+    k_unit_param_type_none = 0U,
+    k_unit_param_type_percent,
+    k_unit_param_type_db,
+    k_unit_param_type_cents,
+    k_unit_param_type_semi,
+    k_unit_param_type_oct,
+    k_unit_param_type_hertz,
+    k_unit_param_type_khertz,
+    k_unit_param_type_bpm,
+    k_unit_param_type_msec,
+    k_unit_param_type_sec,
+    k_unit_param_type_enum,
+    k_unit_param_type_strings,
+    k_unit_param_type_bitmaps,
+    k_unit_param_type_drywet,
+    k_unit_param_type_pan,
+    k_unit_param_type_spread,
+    k_unit_param_type_onoff,
+    k_unit_param_type_midi_note,
+    k_num_unit_param_types
+};
+
+typedef struct unit_runtime_desc {
+    uint16_t target;
+    uint32_t api;
+    uint32_t samplerate;
+    uint16_t frames_per_buffer;
+    uint8_t input_channels;
+    uint8_t output_channels;
+    void * hooks;  // sample bank accessors, unused on the host
+} unit_runtime_desc_t;
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
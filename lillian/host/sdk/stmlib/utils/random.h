@@ -0,0 +1,56 @@
+#pragma once
+/*
+ *  File: random.h
+ *
+ *  Host stand-in for stmlib/utils/random.h
+ *
+ *  Same generator and interface as the unit's patched copy
+ *  (patch/stmlib/utils/random.h: upstream's plus set_state), but with one
+ *  state per thread: host tools render several Synth instances in
+ *  parallel threads, and each instance swaps its own state in for the
+ *  duration of Render (see instance.h). Found before the eurorack tree and
+ *  patch/ on the host include path; the guard keeps the others out if
+ *  they are reached.
+ *
+ */
+
+#ifndef STMLIB_UTILS_RANDOM_H_
+#define STMLIB_UTILS_RANDOM_H_
+
+#include "stmlib/stmlib.h"
+
+namespace stmlib {
+
+class Random {
+public:
+    static inline uint32_t state() { return rng_state_; }
+
+    static inline void set_state(uint32_t state) {
+        rng_state_ = state;
+    }
+
+    static inline void Seed(uint16_t seed) {
+        rng_state_ = seed;
+    }
+
+    static inline uint32_t GetWord() {
+        rng_state_ = rng_state_ * 1664525L + 1013904223L;
+        return state();
+    }
+
+    static inline int16_t GetSample() {
+        return static_cast<int16_t>(GetWord() >> 16);
+    }
+
+    static inline float GetFloat() {
+        return static_cast<float>(GetWord()) / 4294967296.0f;
+    }
+
+private:
+    static thread_local uint32_t rng_state_;
+    DISALLOW_COPY_AND_ASSIGN(Random);
+};
+
+}  // namespace stmlib
+
+#endif  // STMLIB_UTILS_RANDOM_H_
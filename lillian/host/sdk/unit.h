@@ -0,0 +1,88 @@
+#pragma once
+/*
+ *  File: unit.h
+ *
+ *  Host stand-in for the drumlogue SDK common/unit.h
+ *
+ *  Lets the unit sources be compiled and driven on a desktop machine.
+ *  Layouts follow the SDK so that header.c initializes unchanged.
+ *
+ */
+
+#include <stdint.h>
+
+#include "attributes.h"
+#include "runtime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UNIT_API_VERSION (0x00010000U)
+#define UNIT_API_MAJOR_MASK (0x7FFF0000U)
+#define UNIT_API_MINOR_MASK (0x0000FF00U)
+#define UNIT_API_IS_COMPAT(api) \
+    ((((api) & UNIT_API_MAJOR_MASK) == (UNIT_API_VERSION & UNIT_API_MAJOR_MASK)) && \
+     (((api) & UNIT_API_MINOR_MASK) <= (UNIT_API_VERSION & UNIT_API_MINOR_MASK)))
+
+#define UNIT_TARGET_PLATFORM (k_unit_target_drumlogue)
+
+#define UNIT_MAX_PARAM_COUNT (24)
+#define UNIT_PARAM_NAME_LEN (12)
+#define UNIT_NAME_LEN (13)
+
+#pragma pack(push, 1)
+typedef struct unit_param {
+    int16_t min;
+    int16_t max;
+    int16_t center;
+    int16_t init;
+    uint8_t type;
+    uint8_t frac : 4;
+    uint8_t frac_mode : 1;
+    uint8_t reserved : 3;
+    char name[UNIT_PARAM_NAME_LEN + 1];
+} unit_param_t;
+
+typedef struct unit_header {
+    uint32_t header_size;
+    uint32_t target;
+    uint32_t api;
+    uint32_t dev_id;
+    uint32_t unit_id;
+    uint32_t version;
+    char name[UNIT_NAME_LEN + 1];
+    uint32_t num_presets;
+    uint32_t num_params;
+    unit_param_t params[UNIT_MAX_PARAM_COUNT];
+} unit_header_t;
+#pragma pack(pop)
+
+extern const unit_header_t unit_header;
+
+int8_t unit_init(const unit_runtime_desc_t * desc);
+void unit_teardown();
+void unit_reset();
+void unit_resume();
+void unit_suspend();
+void unit_render(const float * in, float * out, uint32_t frames);
+uint8_t unit_get_preset_index();
+const char * unit_get_preset_name(uint8_t idx);
+void unit_load_preset(uint8_t idx);
+int32_t unit_get_param_value(uint8_t id);
+const char * unit_get_param_str_value(uint8_t id, int32_t value);
+const uint8_t * unit_get_param_bmp_value(uint8_t id, int32_t value);
+void unit_set_param_value(uint8_t id, int32_t value);
+void unit_set_tempo(uint32_t tempo);
+void unit_note_on(uint8_t note, uint8_t velocity);
+void unit_note_off(uint8_t note);
+void unit_gate_on(uint8_t velocity);
+void unit_gate_off(void);
+void unit_all_note_off(void);
+void unit_pitch_bend(uint16_t bend);
+void unit_channel_pressure(uint8_t pressure);
+void unit_aftertouch(uint8_t note, uint8_t aftertouch);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -0,0 +1,371 @@
+/*
+ *  File: stress.cc
+ *
+ *  randomized parameter/event stress test
+ *
+ *  Drives the unit callbacks with random but valid sequences of parameter
+ *  writes, notes, gates and preset loads at random frames within a buffer,
+ *  including bursts of Shape changes and odd frame counts, and times every
+ *  unit_render call. A sequence
+ *  fails when a call exceeds the time budget or the output contains NaN or
+ *  values outside [-1, 1]. Failing sequences are minimized and printed as
+ *  event scripts that render and profile can replay.
+ *
+ *  usage: stress [-s seed] [-i iterations] [-n steps] [-b us] [-k failures]
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <unistd.h>
+
+#include "unit.h"
+
+#include "clock.h"
+#include "script.h"
+#include "unit_host.h"
+
+constexpr uint8_t kShapeParam = 1;
+constexpr uint32_t kMaxFrames = 256;
+constexpr int kRetries = 3;
+
+// parameters beyond the header's 24 (see Params in synth.h)
+struct ParamRange {
+    uint8_t id;
+    int16_t min;
+    int16_t max;
+};
+static const ParamRange kHiddenParams[] = {
+    { 26, 0, 4 },   // Signature
+    { 28, 0, 4 },   // VCO_Drift
+    { 29, 0, 1 },   // NativeRate
+    { 30, 0, 128 }, // ControlBlock
+    { 31, 0, 1 },   // EnvRamp
+    { 33, 0, 1 },   // Kit
+    { 34, 0, 8 },   // Unison
+    { 35, 0, 100 }, // UnisonDetune
+};
+constexpr int kNumHiddenParams = sizeof(kHiddenParams) / sizeof(kHiddenParams[0]);
+
+// one unit_render call and the events dispatched before it, with their
+// frame within the call
+struct Step {
+    std::vector<Event> events;
+    uint32_t frames;
+};
+
+enum FailureKind {
+    FAIL_NONE,
+    FAIL_SLOW,
+    FAIL_NAN,
+    FAIL_CLIP,
+};
+
+static const char * const kFailureStr[] = { "none", "slow", "NaN", "clipping" };
+
+struct Failure {
+    FailureKind kind;
+    size_t step;
+    uint64_t ns;
+};
+
+struct Options {
+    uint32_t seed;
+    uint32_t iterations;
+    uint32_t steps;
+    uint64_t budget_ns;  // 0: the deadline of each call
+    uint32_t max_failures;
+};
+
+class Generator {
+public:
+    explicit Generator(uint32_t seed) : rng_(seed) {}
+
+    std::vector<Step> Sequence(uint32_t length) {
+        std::vector<Step> seq(length);
+        for (Step & step : seq) {
+            step.frames = frames();
+            int num_events = pick(0, 3);
+            if (chance(0.05)) {
+                // burst of shape changes within one buffer
+                num_events += pick(2, 8);
+                for (int i = 0; i < num_events; i++) {
+                    step.events.push_back(param(kShapeParam));
+                }
+                continue;
+            }
+            for (int i = 0; i < num_events; i++) {
+                step.events.push_back(event());
+                step.events.back().frame = pick(0, step.frames - 1);
+            }
+            std::stable_sort(step.events.begin(), step.events.end(),
+                             [](const Event & x, const Event & y) { return x.frame < y.frame; });
+        }
+        return seq;
+    }
+
+private:
+    inline int pick(int min, int max) {
+        return std::uniform_int_distribution<int>(min, max)(rng_);
+    }
+
+    inline bool chance(double p) {
+        return std::uniform_real_distribution<double>(0, 1)(rng_) < p;
+    }
+
+    uint32_t frames() {
+        if (chance(0.3)) {
+            return kHostDefaultFrames;
+        }
+        return pick(1, kMaxFrames);
+    }
+
+    Event param(int id) {
+        Event e = {};
+        e.type = EV_PARAM;
+        e.a = id;
+        if (id < static_cast<int>(unit_header.num_params)) {
+            e.b = pick(unit_header.params[id].min, unit_header.params[id].max);
+        } else {
+            for (const ParamRange & r : kHiddenParams) {
+                if (r.id == id) {
+                    e.b = pick(r.min, r.max);
+                }
+            }
+        }
+        return e;
+    }
+
+    Event event() {
+        Event e = {};
+        int r = pick(0, 99);
+        if (r < 20) {
+            e.type = EV_NOTE_ON;
+            e.a = pick(0, 127);
+            e.b = pick(1, 127);
+        } else if (r < 30) {
+            e.type = EV_NOTE_OFF;
+            e.a = pick(0, 127);
+        } else if (r < 35) {
+            e.type = EV_GATE_ON;
+            e.a = pick(1, 127);
+        } else if (r < 40) {
+            e.type = EV_GATE_OFF;
+        } else if (r < 43) {
+            e.type = EV_PRESET;
+            e.a = pick(0, unit_header.num_presets - 1);
+        } else if (r < 60) {
+            e = param(kShapeParam);
+        } else if (r < 65) {
+            e = param(kHiddenParams[pick(0, kNumHiddenParams - 1)].id);
+        } else {
+            e = param(pick(0, unit_header.num_params - 1));
+        }
+        return e;
+    }
+
+    std::mt19937 rng_;
+};
+
+static void reset_unit() {
+    host_unit_init(kHostDefaultFrames);
+    unit_reset();
+    unit_all_note_off();
+}
+
+// Plays a sequence from a freshly initialized unit, stopping at the first
+// failing call.
+static Failure run(const std::vector<Step> & seq, const Options & opt, uint64_t overhead) {
+    static float out[kMaxFrames * 2];
+    reset_unit();
+    for (size_t i = 0; i < seq.size(); i++) {
+        const Step & step = seq[i];
+        for (const Event & e : step.events) {
+            dispatch_event(e, e.frame);
+        }
+        const uint64_t t0 = now_ns();
+        unit_render(nullptr, out, step.frames);
+        const uint64_t t = now_ns() - t0;
+        const uint64_t ns = t > overhead ? t - overhead : 0;
+
+        const uint64_t budget = opt.budget_ns
+            ? opt.budget_ns
+            : static_cast<uint64_t>(step.frames) * 1000000000u / kHostSampleRate;
+        for (uint32_t j = 0; j < step.frames * 2; j++) {
+            if (std::isnan(out[j]) || std::isinf(out[j])) {
+                return { FAIL_NAN, i, ns };
+            }
+            if (std::fabs(out[j]) > 1.f) {
+                return { FAIL_CLIP, i, ns };
+            }
+        }
+        if (ns > budget) {
+            return { FAIL_SLOW, i, ns };
+        }
+    }
+    return { FAIL_NONE, seq.size(), 0 };
+}
+
+// Timing failures are noisy: they must show up in most of the retries.
+static bool reproduces(const std::vector<Step> & seq, FailureKind kind,
+                       const Options & opt, uint64_t overhead) {
+    int hits = 0;
+    const int needed = (kind == FAIL_SLOW) ? kRetries / 2 + 1 : 1;
+    for (int i = 0; i < kRetries && hits < needed; i++) {
+        hits += run(seq, opt, overhead).kind == kind;
+        if (kind != FAIL_SLOW && hits == 0) {
+            break;
+        }
+    }
+    return hits >= needed;
+}
+
+// Removes steps, then single events, as long as the failure reproduces.
+// The last step, whose render call failed, is always kept.
+static std::vector<Step> minimize(std::vector<Step> seq, FailureKind kind,
+                                  const Options & opt, uint64_t overhead) {
+    for (size_t chunk = seq.size() / 2; chunk >= 1; chunk /= 2) {
+        for (size_t i = 0; i + 1 < seq.size();) {
+            const size_t end = std::min(i + chunk, seq.size() - 1);
+            std::vector<Step> candidate(seq.begin(), seq.begin() + i);
+            candidate.insert(candidate.end(), seq.begin() + end, seq.end());
+            if (reproduces(candidate, kind, opt, overhead)) {
+                seq.swap(candidate);
+            } else {
+                i = end;
+            }
+        }
+    }
+    for (size_t i = 0; i < seq.size(); i++) {
+        for (size_t j = 0; j < seq[i].events.size();) {
+            std::vector<Step> candidate = seq;
+            candidate[i].events.erase(candidate[i].events.begin() + j);
+            if (reproduces(candidate, kind, opt, overhead)) {
+                seq.swap(candidate);
+            } else {
+                j++;
+            }
+        }
+    }
+    return seq;
+}
+
+static const char * event_str(const Event & e, char * buf, size_t size) {
+    switch (e.type) {
+    case EV_NOTE_ON:
+        std::snprintf(buf, size, "note_on %d %d", e.a, e.b);
+        break;
+    case EV_NOTE_OFF:
+        std::snprintf(buf, size, "note_off %d", e.a);
+        break;
+    case EV_GATE_ON:
+        std::snprintf(buf, size, "gate_on %d", e.a);
+        break;
+    case EV_GATE_OFF:
+        std::snprintf(buf, size, "gate_off");
+        break;
+    case EV_ALL_NOTE_OFF:
+        std::snprintf(buf, size, "all_off");
+        break;
+    case EV_PARAM:
+        std::snprintf(buf, size, "param %d %d", e.a, e.b);
+        break;
+    case EV_PRESET:
+        std::snprintf(buf, size, "preset %d", e.a);
+        break;
+    }
+    return buf;
+}
+
+// Prints a sequence as an event script, with the frame counts as comments.
+static void print_script(const std::vector<Step> & seq, const Failure & f) {
+    uint64_t frame = 0;
+    char buf[64];
+    for (size_t i = 0; i < seq.size(); i++) {
+        std::printf("# render %u frames%s\n", seq[i].frames,
+                    i == f.step ? "  <-- fails" : "");
+        for (const Event & e : seq[i].events) {
+            std::printf("%.6f %s\n", static_cast<double>(frame + e.frame) / kHostSampleRate,
+                        event_str(e, buf, sizeof(buf)));
+        }
+        frame += seq[i].frames;
+    }
+}
+
+static void usage() {
+    std::fprintf(stderr,
+                 "usage: stress [-s seed] [-i iterations] [-n steps] [-b us] [-k failures]\n"
+                 "  -s  random seed (default 1)\n"
+                 "  -i  number of random sequences (default 100)\n"
+                 "  -n  render calls per sequence (default 2000)\n"
+                 "  -b  time budget per call in us, default: its realtime deadline\n"
+                 "  -k  stop after this many failures (default 1)\n");
+}
+
+int main(int argc, char ** argv) {
+    Options opt = { 1, 100, 2000, 0, 1 };
+
+    int c;
+    while ((c = getopt(argc, argv, "s:i:n:b:k:")) != -1) {
+        switch (c) {
+        case 's':
+            opt.seed = std::strtoul(optarg, nullptr, 0);
+            break;
+        case 'i':
+            opt.iterations = std::atoi(optarg);
+            break;
+        case 'n':
+            opt.steps = std::atoi(optarg);
+            break;
+        case 'b':
+            opt.budget_ns = static_cast<uint64_t>(std::atof(optarg) * 1000);
+            break;
+        case 'k':
+            opt.max_failures = std::atoi(optarg);
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+    if (opt.steps == 0) {
+        usage();
+        return 1;
+    }
+
+    const uint64_t overhead = now_ns_overhead();
+    Generator gen(opt.seed);
+    uint32_t failures = 0;
+
+    for (uint32_t it = 0; it < opt.iterations && failures < opt.max_failures; it++) {
+        std::vector<Step> seq = gen.Sequence(opt.steps);
+        Failure f = run(seq, opt, overhead);
+        if (f.kind == FAIL_NONE) {
+            continue;
+        }
+        seq.resize(f.step + 1);
+        if (!reproduces(seq, f.kind, opt, overhead)) {
+            std::fprintf(stderr, "iteration %u: %s at call %zu did not reproduce\n",
+                         it, kFailureStr[f.kind], f.step);
+            continue;
+        }
+        failures++;
+        std::fprintf(stderr, "iteration %u: %s at call %zu (%.1f us), minimizing...\n",
+                     it, kFailureStr[f.kind], f.step, f.ns / 1000.);
+        seq = minimize(seq, f.kind, opt, overhead);
+        Failure m = run(seq, opt, overhead);
+        std::printf("# seed %u iteration %u: %s, %zu calls, %.1f us\n",
+                    opt.seed, it, kFailureStr[f.kind], seq.size(), m.ns / 1000.);
+        print_script(seq, m);
+        std::printf("\n");
+    }
+
+    std::fprintf(stderr, "%u failing sequence(s) found\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+/*
+ *  File: unit_host.h
+ *
+ *  helpers for driving the unit callbacks from host tools
+ *
+ */
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <strings.h>
+
+#include "unit.h"
+
+constexpr uint32_t kHostSampleRate = 48000;
+constexpr uint16_t kHostDefaultFrames = 64;
+
+// Initializes the unit like the drumlogue runtime does and sets every
+// parameter to its default value. Returns a k_unit_err_* code.
+inline int8_t host_unit_init(uint16_t frames_per_buffer) {
+    unit_runtime_desc_t desc = {};
+    desc.target = unit_header.target;
+    desc.api = UNIT_API_VERSION;
+    desc.samplerate = kHostSampleRate;
+    desc.frames_per_buffer = frames_per_buffer;
+    desc.input_channels = 0;
+    desc.output_channels = 2;
+
+    int8_t err = unit_init(&desc);
+    if (err != k_unit_err_none) {
+        return err;
+    }
+    for (uint32_t i = 0; i < unit_header.num_params; i++) {
+        unit_set_param_value(i, unit_header.params[i].init);
+    }
+    return k_unit_err_none;
+}
+
+// Looks up a parameter by number or by its (unique) header name.
+// Returns -1 for unknown or ambiguous names.
+inline int host_param_id(const char * s) {
+    char * end;
+    long id = std::strtol(s, &end, 10);
+    if (*s && *end == '\0') {
+        return (id >= 0 && id < 256) ? id : -1;
+    }
+    int found = -1;
+    for (uint32_t i = 0; i < unit_header.num_params; i++) {
+        if (strcasecmp(s, unit_header.params[i].name) == 0) {
+            if (found >= 0) {
+                return -1;
+            }
+            found = i;
+        }
+    }
+    return found;
+}
@@ -0,0 +1,83 @@
+#pragma once
+/*
+ *  File: wav.h
+ *
+ *  streaming writer for 32-bit float WAV files
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+class WavWriter {
+public:
+    WavWriter(void) : fp_(nullptr), channels_(0), frames_(0) {}
+    ~WavWriter(void) { Close(); }
+
+    bool Open(const char * path, uint32_t samplerate, uint16_t channels) {
+        Close();
+        fp_ = std::fopen(path, "wb");
+        if (!fp_) {
+            return false;
+        }
+        channels_ = channels;
+        frames_ = 0;
+        samplerate_ = samplerate;
+        writeHeader();
+        return true;
+    }
+
+    inline bool isOpen() const {
+        return fp_ != nullptr;
+    }
+
+    inline void Write(const float * buf, size_t frames) {
+        std::fwrite(buf, sizeof(float) * channels_, frames, fp_);
+        frames_ += frames;
+    }
+
+    void Close() {
+        if (!fp_) {
+            return;
+        }
+        // patch the chunk sizes now that the length is known
+        std::fseek(fp_, 0, SEEK_SET);
+        writeHeader();
+        std::fclose(fp_);
+        fp_ = nullptr;
+    }
+
+private:
+    void write16(uint16_t v) {
+        const uint8_t b[2] = { uint8_t(v), uint8_t(v >> 8) };
+        std::fwrite(b, 1, 2, fp_);
+    }
+
+    void write32(uint32_t v) {
+        const uint8_t b[4] = { uint8_t(v), uint8_t(v >> 8), uint8_t(v >> 16), uint8_t(v >> 24) };
+        std::fwrite(b, 1, 4, fp_);
+    }
+
+    void writeHeader() {
+        const uint32_t block_align = sizeof(float) * channels_;
+        const uint32_t data_size = frames_ * block_align;
+        std::fwrite("RIFF", 1, 4, fp_);
+        write32(36 + data_size);
+        std::fwrite("WAVEfmt ", 1, 8, fp_);
+        write32(16);
+        write16(3);  // WAVE_FORMAT_IEEE_FLOAT
+        write16(channels_);
+        write32(samplerate_);
+        write32(samplerate_ * block_align);
+        write16(block_align);
+        write16(32);
+        std::fwrite("data", 1, 4, fp_);
+        write32(data_size);
+    }
+
+    FILE * fp_;
+    uint16_t channels_;
+    uint32_t samplerate_;
+    uint32_t frames_;
+};
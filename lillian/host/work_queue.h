@@ -0,0 +1,63 @@
+#pragma once
+/*
+ *  File: work_queue.h
+ *
+ *  work-stealing job queue for the host tools
+ *
+ *  Each worker owns a deque: it takes its own jobs from the back and,
+ *  once empty, steals from the front of the other workers' deques. Jobs
+ *  must all be pushed before the workers start.
+ *
+ */
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+template <typename Job>
+class WorkStealingQueue {
+public:
+    explicit WorkStealingQueue(size_t num_workers) : queues_(num_workers) {}
+
+    // Distributes jobs round-robin over the workers.
+    void Push(const Job & job) {
+        Queue & q = queues_[next_++ % queues_.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.jobs.push_back(job);
+    }
+
+    // Returns false when there is no job left anywhere.
+    bool Pop(size_t worker, Job & job, bool & stolen) {
+        stolen = false;
+        {
+            Queue & q = queues_[worker];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.jobs.empty()) {
+                job = q.jobs.back();
+                q.jobs.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues_.size(); i++) {
+            Queue & q = queues_[(worker + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.jobs.empty()) {
+                job = q.jobs.front();
+                q.jobs.pop_front();
+                stolen = true;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<Queue> queues_;
+    size_t next_ = 0;
+};
@@ -0,0 +1,57 @@
+#pragma once
+/*
+ *  File: instance.h
+ *
+ *  independent Synth instances
+ *
+ *  Not part of the logue SDK: unit.cc drives a single Synth through the
+ *  unit_* callbacks, host tools can create any number of instances with
+ *  these functions and render them in parallel threads. An instance holds
+ *  all of its state, including the noise of its oscillators, so instances
+ *  do not affect each other. Render and the other render-thread methods
+ *  of one instance must be called from one thread at a time; its Post*
+ *  methods may be called from another one (see Synth).
+ *
+ */
+
+#include <cstdint>
+#include <new>
+
+#include "unit.h"
+#include "synth.h"
+
+// Creates an instance set up like the unit after unit_init and the
+// runtime's writes of the default parameter values, with its noise
+// seeded from seed. Returns nullptr on failure, with the k_unit_err_*
+// code in err if given.
+inline Synth * lillian_create(const unit_runtime_desc_t & desc, uint32_t seed = kRandomSeed,
+                              int8_t * err = nullptr) {
+    Synth * synth = new (std::nothrow) Synth();
+    int8_t result = k_unit_err_memory;
+    if (synth) {
+        result = synth->Init(&desc);
+    }
+    if (result != k_unit_err_none) {
+        delete synth;
+        if (err) {
+            *err = result;
+        }
+        return nullptr;
+    }
+    synth->Seed(seed);
+    for (uint32_t i = 0; i < unit_header.num_params; i++) {
+        synth->setParameter(i, unit_header.params[i].init);
+    }
+    if (err) {
+        *err = k_unit_err_none;
+    }
+    return synth;
+}
+
+inline void lillian_render(Synth * synth, float * out, uint32_t frames) {
+    synth->Render(out, frames);
+}
+
+inline void lillian_destroy(Synth * synth) {
+    delete synth;
+}
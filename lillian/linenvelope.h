@@ -20,12 +20,15 @@ namespace braids {
 
     class LinEnvelope {
     public:
+        static const uint32_t kBlockSize = 24;
+
         void Init() {
             target_[ENV_SEGMENT_ATTACK] = 65535;
             target_[ENV_SEGMENT_DECAY] = 0;
             target_[ENV_SEGMENT_DEAD] = 0;
             increment_[ENV_SEGMENT_DEAD] = 0;
             prev_trigger_ = 0;
+            Trigger(ENV_SEGMENT_DEAD);
         }
 
         inline EnvelopeSegment segment() const {
@@ -47,18 +50,24 @@ namespace braids {
             phase_ = 0;
         }
 
-        inline uint16_t Render(int trigger) {
-            uint32_t increment = increment_[segment_];
+        // Advances the envelope by size samples; the increments are for
+        // one call per kBlockSize samples.
+        inline uint16_t Render(int trigger, uint32_t size = kBlockSize) {
+            uint64_t increment = static_cast<uint64_t>(increment_[segment_]);
             uint32_t linear;
-            phase_ += increment;
-            if (phase_ < increment) {
-                value_ = Mix(a_, b_, 65535);
+            if (size != kBlockSize) {
+                increment = increment * size / kBlockSize;
+            }
+            uint64_t phase = phase_ + increment;
+            phase_ = static_cast<uint32_t>(phase);
+            if (phase > 0xffffffff) {
+                value_ = mix(a_, b_, 65535);
                 Trigger(static_cast<EnvelopeSegment>(segment_ + 1));
             }
             if (increment_[segment_]) {
-                value_ = Mix(a_, b_, Interpolate824(lut_env_expo, phase_));
-                linear = Mix(a_, b_, phase_ >> 16);
-                value_ = Mix(linear, value_, curve_);
+                value_ = mix(a_, b_, Interpolate824(lut_env_expo, phase_));
+                linear = mix(a_, b_, phase_ >> 16);
+                value_ = mix(linear, value_, curve_);
             }
             if (trigger - prev_trigger_ > 0) {
                 Trigger(ENV_SEGMENT_ATTACK);
@@ -71,11 +80,29 @@ namespace braids {
             prev_trigger_ = 0;
         }
 
+        // True if Render(trigger) would start the attack.
+        inline bool triggers(int trigger) const {
+            return trigger - prev_trigger_ > 0;
+        }
+
+        // Same as Render(trigger) for a dead envelope that trigger does
+        // not start: only the trigger detector follows.
+        inline void Follow(int trigger) {
+            prev_trigger_ = trigger;
+        }
+
         inline void SetCurve(uint16_t value) {
             curve_ = value;
         }
 
     private:
+        // stmlib's Mix() for uint16_t overflows int when a or b is above
+        // 32767, which the optimizer is free to exploit. Same result in
+        // unsigned arithmetic.
+        static inline uint16_t mix(uint32_t a, uint32_t b, uint32_t balance) {
+            return (a * (65535 - balance) + b * balance) >> 16;
+        }
+
         // Phase increments for each segment.
         uint32_t increment_[ENV_NUM_SEGMENTS];
   
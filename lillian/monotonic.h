@@ -0,0 +1,17 @@
+#pragma once
+/*
+ *  File: monotonic.h
+ *
+ *  monotonic clock of the render timing (governor.h, render_stats.h) and
+ *  of the host tools
+ *
+ */
+
+#include <cstdint>
+#include <ctime>
+
+inline uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + ts.tv_nsec;
+}
@@ -0,0 +1,135 @@
+#pragma once
+/*
+ *  File: render_stats.h
+ *
+ *  per-stage timing of Synth::Render
+ *
+ *  Compiled in only when LILLIAN_RENDER_STATS is defined. The render
+ *  thread accumulates the time spent in each stage of a control block and
+ *  publishes the totals once per Render call; any other thread can read a
+ *  consistent snapshot at any time without blocking audio.
+ *
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "monotonic.h"
+
+enum RenderStage {
+    STAGE_ENVELOPE,     // LinEnvelope::Render
+    STAGE_MODULATION,   // getModVal and parameter math
+    STAGE_JITTER,       // VcoJitterSource::Render
+    STAGE_OSCILLATOR,   // MacroOscillator::Render
+    STAGE_CRUSHER,      // sample rate and bit reduction
+    STAGE_OUTPUT,       // VCA, waveshaper and float conversion
+    NUM_RENDER_STAGES
+};
+
+inline const char * renderStageName(int stage) {
+    static const char * const names[NUM_RENDER_STAGES] = {
+        "envelope", "modulation", "jitter", "oscillator", "crusher", "output",
+    };
+    return (stage < NUM_RENDER_STAGES) ? names[stage] : nullptr;
+}
+
+struct RenderStatsSnapshot {
+    uint64_t ns[NUM_RENDER_STAGES];
+    uint64_t blocks;
+    uint64_t frames;
+    uint64_t calls;
+};
+
+class RenderStats {
+public:
+    void Init() {
+        for (int i = 0; i < NUM_RENDER_STAGES; i++) {
+            pending_[i] = 0;
+            total_[i].store(0, std::memory_order_relaxed);
+        }
+        pending_blocks_ = 0;
+        blocks_.store(0, std::memory_order_relaxed);
+        frames_.store(0, std::memory_order_relaxed);
+        calls_.store(0, std::memory_order_relaxed);
+        seq_.store(0, std::memory_order_relaxed);
+    }
+
+    // Render thread: starts timing at the top of Render.
+    inline void Begin() {
+        last_ = now_ns();
+    }
+
+    // Render thread: the time since the previous mark was spent in stage.
+    inline void Mark(RenderStage stage) {
+        uint64_t t = now_ns();
+        pending_[stage] += t - last_;
+        last_ = t;
+    }
+
+    inline void EndBlock() {
+        pending_blocks_++;
+    }
+
+    // Render thread: adds this call's times to the published totals.
+    inline void Publish(size_t frames) {
+        uint32_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int i = 0; i < NUM_RENDER_STAGES; i++) {
+            total_[i].store(total_[i].load(std::memory_order_relaxed) + pending_[i],
+                            std::memory_order_relaxed);
+            pending_[i] = 0;
+        }
+        blocks_.store(blocks_.load(std::memory_order_relaxed) + pending_blocks_,
+                      std::memory_order_relaxed);
+        frames_.store(frames_.load(std::memory_order_relaxed) + frames,
+                      std::memory_order_relaxed);
+        calls_.store(calls_.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+        pending_blocks_ = 0;
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    // Any thread.
+    void Read(RenderStatsSnapshot & s) const {
+        uint32_t seq0;
+        uint32_t seq1;
+        do {
+            seq0 = seq_.load(std::memory_order_acquire);
+            for (int i = 0; i < NUM_RENDER_STAGES; i++) {
+                s.ns[i] = total_[i].load(std::memory_order_relaxed);
+            }
+            s.blocks = blocks_.load(std::memory_order_relaxed);
+            s.frames = frames_.load(std::memory_order_relaxed);
+            s.calls = calls_.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            seq1 = seq_.load(std::memory_order_relaxed);
+        } while ((seq0 & 1) || seq0 != seq1);
+    }
+
+private:
+    // written by the render thread only
+    uint64_t last_;
+    uint64_t pending_[NUM_RENDER_STAGES];
+    uint64_t pending_blocks_;
+
+    // published totals, guarded by the sequence counter
+    std::atomic<uint32_t> seq_;
+    std::atomic<uint64_t> total_[NUM_RENDER_STAGES];
+    std::atomic<uint64_t> blocks_;
+    std::atomic<uint64_t> frames_;
+    std::atomic<uint64_t> calls_;
+};
+
+#ifdef LILLIAN_RENDER_STATS
+#define RENDER_STATS_BEGIN(stats) (stats).Begin()
+#define RENDER_STATS_MARK(stats, stage) (stats).Mark(stage)
+#define RENDER_STATS_END_BLOCK(stats) (stats).EndBlock()
+#define RENDER_STATS_PUBLISH(stats, frames) (stats).Publish(frames)
+#else
+#define RENDER_STATS_BEGIN(stats)
+#define RENDER_STATS_MARK(stats, stage)
+#define RENDER_STATS_END_BLOCK(stats)
+#define RENDER_STATS_PUBLISH(stats, frames)
+#endif
@@ -0,0 +1,250 @@
+#pragma once
+/*
+ *  File: simd.h
+ *
+ *  thin 128-bit SIMD layer for the render path
+ *
+ *  Provides int16x8, int32x4 and float32x4 vectors with a NEON backend for
+ *  the drumlogue, an SSE2/SSE4.1 backend for x86 hosts (AVX2 builds use the
+ *  same 128-bit operations with VEX encoding) and a scalar fallback.
+ *  Define LILLIAN_SIMD_SCALAR to force the scalar backend.
+ *
+ */
+
+#include <cstdint>
+
+#if !defined(LILLIAN_SIMD_SCALAR)
+#if defined(__ARM_NEON)
+#define LILLIAN_SIMD_NEON
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#define LILLIAN_SIMD_SSE
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#else
+#define LILLIAN_SIMD_SCALAR
+#endif
+#endif
+
+namespace simd {
+
+#if defined(LILLIAN_SIMD_NEON)
+
+struct i16x8 { int16x8_t v; };
+struct i32x4 { int32x4_t v; };
+struct f32x4 { float32x4_t v; };
+
+inline i16x8 load(const int16_t * p) { return { vld1q_s16(p) }; }
+inline i32x4 load(const int32_t * p) { return { vld1q_s32(p) }; }
+inline f32x4 load(const float * p) { return { vld1q_f32(p) }; }
+inline void store(int16_t * p, i16x8 a) { vst1q_s16(p, a.v); }
+inline void store(int32_t * p, i32x4 a) { vst1q_s32(p, a.v); }
+inline void store(float * p, f32x4 a) { vst1q_f32(p, a.v); }
+
+inline i16x8 dup_s16(int16_t x) { return { vdupq_n_s16(x) }; }
+inline i32x4 dup_s32(int32_t x) { return { vdupq_n_s32(x) }; }
+inline f32x4 dup_f32(float x) { return { vdupq_n_f32(x) }; }
+
+inline i16x8 add(i16x8 a, i16x8 b) { return { vaddq_s16(a.v, b.v) }; }
+inline i16x8 sub(i16x8 a, i16x8 b) { return { vsubq_s16(a.v, b.v) }; }
+inline i16x8 add_sat(i16x8 a, i16x8 b) { return { vqaddq_s16(a.v, b.v) }; }
+inline i16x8 sub_sat(i16x8 a, i16x8 b) { return { vqsubq_s16(a.v, b.v) }; }
+inline i16x8 bit_and(i16x8 a, i16x8 b) { return { vandq_s16(a.v, b.v) }; }
+
+inline i32x4 add(i32x4 a, i32x4 b) { return { vaddq_s32(a.v, b.v) }; }
+inline i32x4 sub(i32x4 a, i32x4 b) { return { vsubq_s32(a.v, b.v) }; }
+inline i32x4 mul(i32x4 a, i32x4 b) { return { vmulq_s32(a.v, b.v) }; }
+inline i32x4 shr(i32x4 a, int n) { return { vshlq_s32(a.v, vdupq_n_s32(-n)) }; }
+inline i32x4 shl(i32x4 a, int n) { return { vshlq_s32(a.v, vdupq_n_s32(n)) }; }
+
+inline f32x4 add(f32x4 a, f32x4 b) { return { vaddq_f32(a.v, b.v) }; }
+inline f32x4 sub(f32x4 a, f32x4 b) { return { vsubq_f32(a.v, b.v) }; }
+inline f32x4 mul(f32x4 a, f32x4 b) { return { vmulq_f32(a.v, b.v) }; }
+// a + b * c
+inline f32x4 mla(f32x4 a, f32x4 b, f32x4 c) { return { vmlaq_f32(a.v, b.v, c.v) }; }
+
+inline i32x4 widen_lo(i16x8 a) { return { vmovl_s16(vget_low_s16(a.v)) }; }
+inline i32x4 widen_hi(i16x8 a) { return { vmovl_s16(vget_high_s16(a.v)) }; }
+inline i16x8 narrow_sat(i32x4 lo, i32x4 hi) {
+    return { vcombine_s16(vqmovn_s32(lo.v), vqmovn_s32(hi.v)) };
+}
+inline f32x4 to_f32(i32x4 a) { return { vcvtq_f32_s32(a.v) }; }
+inline i32x4 to_s32(f32x4 a) { return { vcvtq_s32_f32(a.v) }; }
+
+// p[0] = a0, p[1] = b0, p[2] = a1, ...
+inline void store_interleaved(float * p, f32x4 a, f32x4 b) {
+    float32x4x2_t ab;
+    ab.val[0] = a.v;
+    ab.val[1] = b.v;
+    vst2q_f32(p, ab);
+}
+inline void store_interleaved(int16_t * p, i16x8 a, i16x8 b) {
+    int16x8x2_t ab;
+    ab.val[0] = a.v;
+    ab.val[1] = b.v;
+    vst2q_s16(p, ab);
+}
+inline void load_interleaved(const float * p, f32x4 & a, f32x4 & b) {
+    float32x4x2_t ab = vld2q_f32(p);
+    a.v = ab.val[0];
+    b.v = ab.val[1];
+}
+
+// one stereo frame with the same value on both channels
+inline void store_stereo(float * p, float x) { vst1_f32(p, vdup_n_f32(x)); }
+
+#elif defined(LILLIAN_SIMD_SSE)
+
+struct i16x8 { __m128i v; };
+struct i32x4 { __m128i v; };
+struct f32x4 { __m128 v; };
+
+inline i16x8 load(const int16_t * p) { return { _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)) }; }
+inline i32x4 load(const int32_t * p) { return { _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)) }; }
+inline f32x4 load(const float * p) { return { _mm_loadu_ps(p) }; }
+inline void store(int16_t * p, i16x8 a) { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), a.v); }
+inline void store(int32_t * p, i32x4 a) { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), a.v); }
+inline void store(float * p, f32x4 a) { _mm_storeu_ps(p, a.v); }
+
+inline i16x8 dup_s16(int16_t x) { return { _mm_set1_epi16(x) }; }
+inline i32x4 dup_s32(int32_t x) { return { _mm_set1_epi32(x) }; }
+inline f32x4 dup_f32(float x) { return { _mm_set1_ps(x) }; }
+
+inline i16x8 add(i16x8 a, i16x8 b) { return { _mm_add_epi16(a.v, b.v) }; }
+inline i16x8 sub(i16x8 a, i16x8 b) { return { _mm_sub_epi16(a.v, b.v) }; }
+inline i16x8 add_sat(i16x8 a, i16x8 b) { return { _mm_adds_epi16(a.v, b.v) }; }
+inline i16x8 sub_sat(i16x8 a, i16x8 b) { return { _mm_subs_epi16(a.v, b.v) }; }
+inline i16x8 bit_and(i16x8 a, i16x8 b) { return { _mm_and_si128(a.v, b.v) }; }
+
+inline i32x4 add(i32x4 a, i32x4 b) { return { _mm_add_epi32(a.v, b.v) }; }
+inline i32x4 sub(i32x4 a, i32x4 b) { return { _mm_sub_epi32(a.v, b.v) }; }
+inline i32x4 mul(i32x4 a, i32x4 b) {
+#if defined(__SSE4_1__)
+    return { _mm_mullo_epi32(a.v, b.v) };
+#else
+    __m128i even = _mm_mul_epu32(a.v, b.v);
+    __m128i odd = _mm_mul_epu32(_mm_srli_si128(a.v, 4), _mm_srli_si128(b.v, 4));
+    return { _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0))) };
+#endif
+}
+inline i32x4 shr(i32x4 a, int n) { return { _mm_sra_epi32(a.v, _mm_cvtsi32_si128(n)) }; }
+inline i32x4 shl(i32x4 a, int n) { return { _mm_sll_epi32(a.v, _mm_cvtsi32_si128(n)) }; }
+
+inline f32x4 add(f32x4 a, f32x4 b) { return { _mm_add_ps(a.v, b.v) }; }
+inline f32x4 sub(f32x4 a, f32x4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline f32x4 mul(f32x4 a, f32x4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+inline f32x4 mla(f32x4 a, f32x4 b, f32x4 c) { return { _mm_add_ps(a.v, _mm_mul_ps(b.v, c.v)) }; }
+
+inline i32x4 widen_lo(i16x8 a) {
+#if defined(__SSE4_1__)
+    return { _mm_cvtepi16_epi32(a.v) };
+#else
+    return { _mm_srai_epi32(_mm_unpacklo_epi16(a.v, a.v), 16) };
+#endif
+}
+inline i32x4 widen_hi(i16x8 a) {
+#if defined(__SSE4_1__)
+    return { _mm_cvtepi16_epi32(_mm_srli_si128(a.v, 8)) };
+#else
+    return { _mm_srai_epi32(_mm_unpackhi_epi16(a.v, a.v), 16) };
+#endif
+}
+inline i16x8 narrow_sat(i32x4 lo, i32x4 hi) { return { _mm_packs_epi32(lo.v, hi.v) }; }
+inline f32x4 to_f32(i32x4 a) { return { _mm_cvtepi32_ps(a.v) }; }
+inline i32x4 to_s32(f32x4 a) { return { _mm_cvttps_epi32(a.v) }; }
+
+inline void store_interleaved(float * p, f32x4 a, f32x4 b) {
+    _mm_storeu_ps(p, _mm_unpacklo_ps(a.v, b.v));
+    _mm_storeu_ps(p + 4, _mm_unpackhi_ps(a.v, b.v));
+}
+inline void store_interleaved(int16_t * p, i16x8 a, i16x8 b) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_unpacklo_epi16(a.v, b.v));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 8), _mm_unpackhi_epi16(a.v, b.v));
+}
+inline void load_interleaved(const float * p, f32x4 & a, f32x4 & b) {
+    __m128 x = _mm_loadu_ps(p);
+    __m128 y = _mm_loadu_ps(p + 4);
+    a.v = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+    b.v = _mm_shuffle_ps(x, y, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+inline void store_stereo(float * p, float x) { p[0] = p[1] = x; }
+
+#else  // LILLIAN_SIMD_SCALAR
+
+struct i16x8 { int16_t v[8]; };
+struct i32x4 { int32_t v[4]; };
+struct f32x4 { float v[4]; };
+
+#define SIMD_LANES(type, n, expr) \
+    type r; for (int i = 0; i < n; i++) { r.v[i] = (expr); } return r
+
+inline int16_t sat16(int32_t x) {
+    return x > 32767 ? 32767 : (x < -32768 ? -32768 : x);
+}
+
+inline i16x8 load(const int16_t * p) { SIMD_LANES(i16x8, 8, p[i]); }
+inline i32x4 load(const int32_t * p) { SIMD_LANES(i32x4, 4, p[i]); }
+inline f32x4 load(const float * p) { SIMD_LANES(f32x4, 4, p[i]); }
+inline void store(int16_t * p, i16x8 a) { for (int i = 0; i < 8; i++) { p[i] = a.v[i]; } }
+inline void store(int32_t * p, i32x4 a) { for (int i = 0; i < 4; i++) { p[i] = a.v[i]; } }
+inline void store(float * p, f32x4 a) { for (int i = 0; i < 4; i++) { p[i] = a.v[i]; } }
+
+inline i16x8 dup_s16(int16_t x) { SIMD_LANES(i16x8, 8, x); }
+inline i32x4 dup_s32(int32_t x) { SIMD_LANES(i32x4, 4, x); }
+inline f32x4 dup_f32(float x) { SIMD_LANES(f32x4, 4, x); }
+
+inline i16x8 add(i16x8 a, i16x8 b) { SIMD_LANES(i16x8, 8, int16_t(a.v[i] + b.v[i])); }
+inline i16x8 sub(i16x8 a, i16x8 b) { SIMD_LANES(i16x8, 8, int16_t(a.v[i] - b.v[i])); }
+inline i16x8 add_sat(i16x8 a, i16x8 b) { SIMD_LANES(i16x8, 8, sat16(a.v[i] + b.v[i])); }
+inline i16x8 sub_sat(i16x8 a, i16x8 b) { SIMD_LANES(i16x8, 8, sat16(a.v[i] - b.v[i])); }
+inline i16x8 bit_and(i16x8 a, i16x8 b) { SIMD_LANES(i16x8, 8, a.v[i] & b.v[i]); }
+
+inline i32x4 add(i32x4 a, i32x4 b) { SIMD_LANES(i32x4, 4, a.v[i] + b.v[i]); }
+inline i32x4 sub(i32x4 a, i32x4 b) { SIMD_LANES(i32x4, 4, a.v[i] - b.v[i]); }
+inline i32x4 mul(i32x4 a, i32x4 b) { SIMD_LANES(i32x4, 4, a.v[i] * b.v[i]); }
+inline i32x4 shr(i32x4 a, int n) { SIMD_LANES(i32x4, 4, a.v[i] >> n); }
+inline i32x4 shl(i32x4 a, int n) { SIMD_LANES(i32x4, 4, a.v[i] << n); }
+
+inline f32x4 add(f32x4 a, f32x4 b) { SIMD_LANES(f32x4, 4, a.v[i] + b.v[i]); }
+inline f32x4 sub(f32x4 a, f32x4 b) { SIMD_LANES(f32x4, 4, a.v[i] - b.v[i]); }
+inline f32x4 mul(f32x4 a, f32x4 b) { SIMD_LANES(f32x4, 4, a.v[i] * b.v[i]); }
+inline f32x4 mla(f32x4 a, f32x4 b, f32x4 c) { SIMD_LANES(f32x4, 4, a.v[i] + b.v[i] * c.v[i]); }
+
+inline i32x4 widen_lo(i16x8 a) { SIMD_LANES(i32x4, 4, a.v[i]); }
+inline i32x4 widen_hi(i16x8 a) { SIMD_LANES(i32x4, 4, a.v[i + 4]); }
+inline i16x8 narrow_sat(i32x4 lo, i32x4 hi) {
+    SIMD_LANES(i16x8, 8, sat16(i < 4 ? lo.v[i] : hi.v[i - 4]));
+}
+inline f32x4 to_f32(i32x4 a) { SIMD_LANES(f32x4, 4, static_cast<float>(a.v[i])); }
+inline i32x4 to_s32(f32x4 a) { SIMD_LANES(i32x4, 4, static_cast<int32_t>(a.v[i])); }
+
+inline void store_interleaved(float * p, f32x4 a, f32x4 b) {
+    for (int i = 0; i < 4; i++) {
+        p[2 * i] = a.v[i];
+        p[2 * i + 1] = b.v[i];
+    }
+}
+inline void store_interleaved(int16_t * p, i16x8 a, i16x8 b) {
+    for (int i = 0; i < 8; i++) {
+        p[2 * i] = a.v[i];
+        p[2 * i + 1] = b.v[i];
+    }
+}
+inline void load_interleaved(const float * p, f32x4 & a, f32x4 & b) {
+    for (int i = 0; i < 4; i++) {
+        a.v[i] = p[2 * i];
+        b.v[i] = p[2 * i + 1];
+    }
+}
+
+inline void store_stereo(float * p, float x) { p[0] = p[1] = x; }
+
+#undef SIMD_LANES
+
+#endif
+
+}  // namespace simd
@@ -11,24 +11,30 @@
 #include <cstdint>
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 
 #include <algorithm>
 
-#include <arm_neon.h>
-
 #include "unit.h"  // Note: Include common definitions for all units
 
 #include "stmlib/utils/dsp.h"
+#include "stmlib/utils/random.h"
 //#include "braids/envelope.h"
 #include "braids/macro_oscillator.h"
 #include "braids/signature_waveshaper.h"
 #include "braids/vco_jitter_source.h"
+#include "decimator.h"
+#include "event_queue.h"
+#include "governor.h"
 #include "linenvelope.h"
+#include "render_stats.h"
+#include "simd.h"
+#include "unison.h"
 
 using namespace stmlib;
 
 constexpr size_t PRESET_COUNT = 9;
-const char *PresetNameStr[PRESET_COUNT] = {
+const char * const PresetNameStr[PRESET_COUNT] = {
     "Init",
     "SpcVoice",
     "BrokenAI",
@@ -70,6 +76,13 @@ enum Params {
     Signature,
     VCO_Flatten,
     VCO_Drift,
+    NativeRate,
+    ControlBlock,
+    EnvRamp,
+    CpuLoad,    // read only: governor load in percent
+    Kit,
+    Unison,        // oscillator copies, 0 and 1: off
+    UnisonDetune,  // cents of the outermost copies, default 25
     PARAMCOUNT,
 };
 
@@ -87,6 +100,37 @@ enum ModulationSrc {
     MODSRCCOUNT
 };
 
+enum ModDest {
+    DEST_TIMBRE,
+    DEST_COLOR,
+    DEST_FM,
+    DEST_VCA,
+    MODDESTCOUNT
+};
+
+// A modulation source as
+// ((env * EG1 + env2 * EG2) >> shift) + mul16 * (EG1 * EG2 >> 16) + mul15 * (EG1 * EG2 >> 15)
+struct ModSource {
+    int8_t env;
+    int8_t env2;
+    uint8_t shift;
+    int8_t mul16;
+    int8_t mul15;
+};
+
+const ModSource mod_sources[MODSRCCOUNT] = {
+    { 1,  0, 0,  0,  0 },   // SRC_EG1
+    { 0,  1, 0,  0,  0 },   // SRC_EG2
+    { 1,  1, 1,  0,  0 },   // SRC_SUM
+    { 0,  0, 0,  1,  0 },   // SRC_MUL
+    { 1, -1, 0,  0,  0 },   // SRC_A_MINUS_B
+    { -1, 1, 0,  0,  0 },   // SRC_B_MINUS_A
+    { 1,  0, 0, -1,  0 },   // SRC_A_MINUS_AB
+    { 0,  1, 0, -1,  0 },   // SRC_B_MINUS_AB
+    { 1,  1, 0, -1,  0 },   // SRC_A_PLUS_B_MINUS_AB
+    { 1,  1, 0,  0, -1 },   // SRC_A_PLUS_B_MINUS_2AB
+};
+
 enum EGTrigger {
     EG_GATEON,
     EG_GATEOFF,
@@ -99,6 +143,27 @@ enum EGTrigger {
     EGTRIGGERCOUNT
 };
 
+// The parameters a voice plays with, as Render uses them: built by
+// setParameter from the panel, and at Init from the preset of every drum
+// of the kit.
+struct VoiceTemplate {
+    ModSource mod_route[MODDESTCOUNT];
+    int16_t mod_int[MODDESTCOUNT];
+    int16_t timbre;
+    int16_t color;
+    int16_t note_pitch;    // kit only: the pitch of the drum
+    int16_t pitch_offset;  // octave and pitch
+    uint16_t curve;
+    uint16_t curve2;
+    uint8_t shape;
+    uint8_t trigger;
+    uint8_t trigger2;
+    uint8_t attack;
+    uint8_t decay;
+    uint8_t attack2;
+    uint8_t decay2;
+};
+
 inline float note2freq(float note) {
     return (440.f / 32) * powf(2, (note - 9.0) / 12);
 }
@@ -121,7 +186,111 @@ const uint16_t bit_reduction_masks[] = {
 
 const uint16_t decimation_factors[] = { 12, 8, 6, 3, 2, 1 };
 
+// Samples between envelope and modulation updates. The ControlBlock
+// parameter overrides it at runtime, from 8 to 128 samples (0: default).
+#ifndef LILLIAN_CONTROL_BLOCK_SIZE
+#define LILLIAN_CONTROL_BLOCK_SIZE 24
+#endif
+constexpr uint16_t kControlBlockSize = LILLIAN_CONTROL_BLOCK_SIZE;
+// samples per oscillator call while pitch, timbre or color ramp
+constexpr size_t kRampChunk = 8;
+
+// Voices in the pool. Each one has its own oscillator, envelopes, jitter
+// source, reducer and smoothing state; 1 is the original monophonic unit.
+#ifndef LILLIAN_VOICES
+#define LILLIAN_VOICES 1
+#endif
+constexpr size_t kNumVoices = LILLIAN_VOICES;
+
+// note of a voice started by GateOn rather than NoteOn
+constexpr uint8_t kGateNote = 0x80;
+
+// Drums of the kit. With the Kit parameter on, a note plays the drum
+// note % kKitSize in every octave: a preset at a fixed note.
+constexpr size_t kKitSize = 12;
+
+struct KitSlot {
+    uint8_t preset;  // index in Presets
+    uint8_t note;
+};
+
+// Initial noise state of an instance, the one stmlib starts from.
+constexpr uint32_t kRandomSeed = 0x21;
+
+// At most one pending event per parameter, the rest is for notes and gates.
+constexpr size_t kEventQueueSize = 128;
+constexpr size_t kParamFlagWords = (PARAMCOUNT + 31) / 32;
+
+// 12 * 128 * log2(decimation factor): pitch offset that keeps the
+// oscillator in tune when it runs at 48K / decimation factor.
+const int16_t decimation_pitch_offsets[] = { 5507, 4608, 3971, 2435, 1536, 0 };
+
+// A control value ramping linearly across a control block, in fixed point.
+class ControlRamp {
+public:
+    static const int kShift = 8;
+
+    inline int32_t value() const {
+        return value_ >> kShift;
+    }
+
+    inline int32_t increment() const {
+        return increment_;
+    }
+
+    inline bool ramping() const {
+        return increment_ != 0;
+    }
+
+    // fixed point value after samples
+    inline int32_t at(size_t samples) const {
+        return value_ + increment_ * static_cast<int32_t>(samples);
+    }
+
+    inline void Jump(int32_t target) {
+        value_ = target << kShift;
+        increment_ = 0;
+    }
+
+    inline void Target(int32_t target, uint16_t samples) {
+        increment_ = ((target << kShift) - value_) / samples;
+    }
+
+    inline void Advance(size_t samples) {
+        value_ = at(samples);
+    }
+
+private:
+    int32_t value_;
+    int32_t increment_;
+};
+
 class Synth {
+    // Events posted by the unit_* callbacks, applied by Render. Nested, so
+    // they do not clash with the host tools' script events. A parameter
+    // event carries no value: the latest value written is read when it is
+    // applied, so repeated writes cost one update per Render call.
+    enum EventType {
+        EVENT_PARAM,
+        EVENT_NOTE_ON,
+        EVENT_NOTE_OFF,
+        EVENT_GATE_ON,
+        EVENT_GATE_OFF,
+        EVENT_ALL_NOTE_OFF,
+        EVENT_RESET,
+    };
+
+    // Notes and gates can be timestamped with an offset in frames from the
+    // start of the next Render call, which splits its blocks there. Events
+    // apply in the order they are posted, at their offset or later; offsets
+    // past the end of the call apply at its end.
+    struct Event {
+        uint8_t type;
+        uint8_t a;  // parameter id or note
+        uint8_t b;  // velocity
+        uint16_t offset;
+    };
+
 public:
     Synth(void) {}
     ~Synth(void) {}
@@ -133,12 +302,63 @@ public:
         if (desc->output_channels != 2)  // should be stereo output
             return k_unit_err_geometry;
 
+        std::memset(p_, 0, sizeof(p_));
+        p_[UnisonDetune] = UnisonOscillator::kDefaultDetune;
+        for (int i = 0; i < PARAMCOUNT; i++) {
+            posted_[i].store(p_[i], std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < kParamFlagWords; i++) {
+            flags_[i].store(0, std::memory_order_relaxed);
+        }
+        events_.Init();
+        preset_ = 0;
+        note_pitch_ = 0;
+        panel_ = VoiceTemplate();
+        for (int i = 0; i < MODDESTCOUNT; i++) {
+            updateModRoute(static_cast<ModDest>(i));
+        }
+        for (size_t i = 0; i < kKitSize; i++) {
+            buildTemplate(kit_[i], Presets[KitSlots[i].preset]);
+            kit_[i].note_pitch = KitSlots[i].note << 7;
+        }
+        kit_on_ = false;
+        control_block_ = kControlBlockSize;
+        control_step_ = control_block_;
+        control_coarse_ = 0;
+        env_ramp_ = false;
+        note_count_ = 0;
+        random_state_ = kRandomSeed;
+
         std::memset(&osc_, 0, sizeof(osc_));
-        osc_.Init();
-        envelope_.Init();
-        envelope2_.Init();
+        for (size_t v = 0; v < kNumVoices; v++) {
+            pitch_[v] = 0;
+            amp_[v] = 0;
+            gate_[v] = 0;
+            note_[v] = kGateNote;
+            started_[v] = 0;
+            muted_[v] = false;
+            template_[v] = &panel_;
+            gain_lp_[v] = 0;
+            control_remaining_[v] = 0;
+            pitch_ramp_[v].Jump(0);
+            timbre_ramp_[v].Jump(0);
+            color_ramp_[v].Jump(0);
+            gain_ramp_[v].Jump(0);
+            note_start_[v] = false;
+            jitter_[v] = 0;
+            jitter_count_[v] = 0;
+
+            osc_[v].Init();
+            envelope_[v].Init();
+            envelope2_[v].Init();
+            decimator_[v].Init();
+            jitter_source_[v].Init();
+        }
         ws_.Init(0x42636877U); // in the original src, MPU's unique id is used 
-        jitter_source_.Init();
+        governor_.Init(desc->samplerate);
+#ifdef LILLIAN_RENDER_STATS
+        stats_.Init();
+#endif
 
         return k_unit_err_none;
     }
@@ -146,79 +366,148 @@ public:
     inline void Teardown() {}
 
     inline void Reset() {
-        gate_ = 0;
+        for (size_t v = 0; v < kNumVoices; v++) {
+            gate_[v] = 0;
+        }
     }
 
     inline void Resume() {}
 
+    // Restarts the noise of the oscillators and of the VCO drift from
+    // seed. Each instance has its own noise, independent of the others.
+    inline void Seed(uint32_t seed) {
+        random_state_ = seed;
+    }
+
     inline void Suspend() {}
 
-    fast_inline void Render(float * out, size_t frames) {
-        float * __restrict out_p = out;
-        const int bufsize = 24; // size of temp_buffer in macro_oscillator.h
+    // The Post* methods and getPostedParameterValue may be called from
+    // another thread than Render; they queue the change for the next
+    // Render call instead of touching the render state. The other methods
+    // must be called from the render thread.
+
+    // A parameter written several times before the next Render call is
+    // applied once, with the last value, at the position of the first
+    // write in the queue.
+    inline void PostParameter(uint8_t index, int32_t value) {
+        if (index >= PARAMCOUNT) {
+            return;
+        }
+        posted_[index].store(value, std::memory_order_relaxed);
+        const uint_fast32_t bit = 1u << (index & 31);
+        if (!(flags_[index >> 5].fetch_or(bit, std::memory_order_acq_rel) & bit)
+            && !events_.Push({ EVENT_PARAM, index, 0, 0 })) {
+            // Queue full: the write is dropped, like a note would be, and
+            // the flag cleared so that the next write queues an event.
+            flags_[index >> 5].fetch_and(~bit, std::memory_order_acq_rel);
+        }
+    }
 
-        int16_t buf[bufsize] = {};
-        const uint8_t sync[bufsize] = {};
-        int16_t env1trigger = getTrigger(p_[EG1Trigger]);
-        int16_t env2trigger = getTrigger(p_[EG2Trigger]);
-        size_t decimation_factor = decimation_factors[p_[SampleRate]];
-        uint16_t bit_mask = bit_reduction_masks[p_[Resolution]];
-        uint16_t signature = p_[Signature] * p_[Signature] * 4095;
-        static uint32_t n = 0;
-        static int16_t current_sample = 0;
-        for(uint32_t p = 0; p < frames; p += bufsize) {
-            uint32_t env1 = envelope_.Render(env1trigger);
-            uint32_t env2 = envelope2_.Render(env2trigger);
-            uint32_t env_val;
-            uint32_t env_int;
-
-            // Set timbre and color: parameter value + internal modulation.
-            int32_t timbre = timbre_;
-            env_val = getModVal(p_[ModSrcTimbre], env1, env2);
-            env_int = clipminmax(0, p_[ModIntTimbre], 31);
-            timbre += env_val * env_int >> 6;
-            CONSTRAIN(timbre, 0, 32767);
-
-            int32_t color = color_;
-            env_val = getModVal(p_[ModSrcColor], env1, env2);
-            env_int = clipminmax(0, p_[ModIntColor], 31);
-            color += env_val * env_int >> 6;
-            CONSTRAIN(color, 0, 32767);
-            osc_.set_parameters(timbre, color);
-
-            int32_t pitch = pitch_;
-            env_val = getModVal(p_[ModSrcFM], env1, env2);
-            env_int = clipminmax(0, p_[ModIntFM], 31);
-            pitch += jitter_source_.Render(p_[VCO_Drift]);
-            pitch += p_[Pitch] + p_[Octave] * 12 * 128;
-            pitch += env_val * env_int >> 7;
-
-            if (pitch > 16383) {
-                pitch = 16383;
-            } else if (pitch < 0) {
-                pitch = 0;
-            }
-
-            osc_.set_pitch(pitch);
-
-            size_t r_size = (bufsize < (frames - p)) ? bufsize : frames - p;
-            osc_.Render(sync, buf, r_size);
-
-            env_val = getModVal(p_[ModSrcVCA], env1, env2);
-            int32_t gain = (env_val * p_[ModIntVCA] >> 5);
-            gain += (31 - p_[ModIntVCA]) * (gate_ > 0) << 10;
-            
-            // Copy to the buffer with sample rate and bit reduction applied.
-            for(uint32_t i = 0; i < r_size ; i++, n++, out_p += 2) {
-                if ((n % decimation_factor) == 0) {
-                    current_sample = buf[i] & bit_mask;
+    inline int32_t getPostedParameterValue(uint8_t index) const {
+        if (index == CpuLoad) {
+            return getParameterValue(index);
+        }
+        return (index < PARAMCOUNT) ? posted_[index].load(std::memory_order_relaxed) : 0;
+    }
+
+    // Notes and gates are dropped if the queue is full.
+    inline void PostNoteOn(uint8_t note, uint8_t velocity, uint16_t offset = 0) {
+        events_.Push({ EVENT_NOTE_ON, note, velocity, offset });
+    }
+
+    inline void PostNoteOff(uint8_t note, uint16_t offset = 0) {
+        events_.Push({ EVENT_NOTE_OFF, note, 0, offset });
+    }
+
+    inline void PostGateOn(uint8_t velocity, uint16_t offset = 0) {
+        events_.Push({ EVENT_GATE_ON, 0, velocity, offset });
+    }
+
+    inline void PostGateOff(uint16_t offset = 0) {
+        events_.Push({ EVENT_GATE_OFF, 0, 0, offset });
+    }
+
+    inline void PostAllNoteOff(uint16_t offset = 0) {
+        events_.Push({ EVENT_ALL_NOTE_OFF, 0, 0, offset });
+    }
+
+    inline void PostReset() {
+        events_.Push({ EVENT_RESET, 0, 0, 0 });
+    }
+
+    inline void PostLoadPreset(uint8_t idx) {
+        if (idx < PRESET_COUNT) {
+            preset_ = idx;
+            for (int i = 0; i < 24; i++) {
+                PostParameter(i, Presets[idx][i]);
+            }
+        }
+    }
+
+#ifdef LILLIAN_RENDER_STATS
+    // Safe to call from any thread while rendering.
+    inline void getRenderStats(RenderStatsSnapshot & stats) const {
+        stats_.Read(stats);
+    }
+#endif
+
+    fast_inline void Render(float * out, size_t frames) {
+        // The oscillators and the jitter sources draw from stmlib's
+        // Random: the state of this instance replaces the one of the
+        // thread for the duration of the call. set_state restores all 32
+        // bits (Seed takes 16), see patch/stmlib/utils/random.h.
+        const uint32_t thread_random_state = Random::state();
+        Random::set_state(random_state_);
+
+        // Events due at the start are applied before the settings are
+        // read; the ones later in the call split it at their offset.
+        size_t next_event = applyEvents(0, frames);
+        RenderSettings rs;
+        readSettings(rs);
+        RENDER_STATS_BEGIN(stats_);
+        governor_.BeginCall();
+        for (size_t p = 0; p < frames; ) {
+            if (next_event <= p) {
+                next_event = applyEvents(p, frames);
+                readSettings(rs);
+            }
+            // The first voice stores into out, the others add to it.
+            // Idle voices are skipped until the next event.
+            const size_t size = std::min(frames, next_event) - p;
+            bool mixed = false;
+            for (size_t v = 0; v < kNumVoices; v++) {
+                if (!isIdle(v, rs)) {
+                    governor_.BeginVoice();
+                    renderVoice(v, rs, out + p * 2, size, mixed);
+                    governor_.EndVoice(size);
+                    mixed = true;
+                } else {
+                    // a falling gate must still be seen, or the next
+                    // note would not retrigger the envelopes
+                    envelope_[v].Follow(rs.env1trigger[v]);
+                    envelope2_[v].Follow(rs.env2trigger[v]);
+                    if (rs.signature) {
+                        renderSilence(v, out + p * 2, size, rs.signature, mixed);
+                        mixed = true;
+                    }
                 }
-                int16_t sample = current_sample * gain_lp_ >> 16;
-                gain_lp_ += (gain - gain_lp_) >> 4;
-                int16_t warped = ws_.Transform(sample);
-                vst1_f32(out_p, vdup_n_f32(amp_ * Mix(sample, warped, signature) / 32768.f));
             }
+            if (!mixed) {
+                std::memset(out + p * 2, 0, size * 2 * sizeof(float));
+            }
+            p += size;
         }
+        applyEvents(frames, frames);
+        if (governor_.EndCall(frames, soundingVoices())) {
+            steal(chooseVictim());
+        }
+        if (governor_.coarse() != control_coarse_) {
+            updateControlStep();
+        }
+        RENDER_STATS_PUBLISH(stats_, frames);
+
+        random_state_ = Random::state();
+        Random::set_state(thread_random_state);
     }
 
     inline void setParameter(uint8_t index, int32_t value) {
@@ -226,41 +515,127 @@ public:
         switch (index) {
         case Note:    // 0..127
             CONSTRAIN(value, 0, 127);
-            pitch_ = value << 7;
+            note_pitch_ = value << 7;
+            for (size_t v = 0; v < kNumVoices; v++) {
+                if (note_[v] == kGateNote && template_[v] == &panel_) {
+                    pitch_[v] = note_pitch_;
+                }
+            }
             break;
         case Shape:   // 0..46
             CONSTRAIN(value, 0, 46);
-            osc_.set_shape(static_cast<braids::MacroOscillatorShape>(value));
+            panel_.shape = value;
+            for (size_t v = 0; v < kNumVoices; v++) {
+                if (template_[v] == &panel_) {
+                    osc_[v].set_shape(static_cast<braids::MacroOscillatorShape>(value));
+                }
+            }
             break;
         case Param1:  // -256..255
-            // timbre and color must be 0..32767
-            CONSTRAIN(value, -2560, 256);
-            timbre_ = (value + 256) << 6;
+            panel_.timbre = toTimbre(value);
             break;
         case Param2:
-            CONSTRAIN(value, -2560, 256);
-            color_ = (value + 256) << 6;
+            panel_.color = toTimbre(value);
             break;
             break;
         case Attack:
         case Decay:
-            envelope_.Update(p_[Attack], p_[Decay]);
+            panel_.attack = p_[Attack];
+            panel_.decay = p_[Decay];
+            for (size_t v = 0; v < kNumVoices; v++) {
+                if (template_[v] == &panel_) {
+                    envelope_[v].Update(p_[Attack], p_[Decay]);
+                }
+            }
             break;
         case Attack2:
         case Decay2:
-            envelope2_.Update(p_[Attack2], p_[Decay2]);
+            panel_.attack2 = p_[Attack2];
+            panel_.decay2 = p_[Decay2];
+            for (size_t v = 0; v < kNumVoices; v++) {
+                if (template_[v] == &panel_) {
+                    envelope2_[v].Update(p_[Attack2], p_[Decay2]);
+                }
+            }
+            break;
+        case ModSrcTimbre:
+        case ModIntTimbre:
+            updateModRoute(DEST_TIMBRE);
+            break;
+        case ModSrcColor:
+        case ModIntColor:
+            updateModRoute(DEST_COLOR);
+            break;
+        case ModSrcFM:
+        case ModIntFM:
+            updateModRoute(DEST_FM);
+            break;
+        case ModSrcVCA:
+        case ModIntVCA:
+            updateModRoute(DEST_VCA);
             break;
         case EG1Curve:
-            envelope_.SetCurve(value << 9);
+            panel_.curve = value << 9;
+            for (size_t v = 0; v < kNumVoices; v++) {
+                if (template_[v] == &panel_) {
+                    envelope_[v].SetCurve(panel_.curve);
+                }
+            }
             break;
         case EG2Curve:
-            envelope2_.SetCurve(value << 9);
+            panel_.curve2 = value << 9;
+            for (size_t v = 0; v < kNumVoices; v++) {
+                if (template_[v] == &panel_) {
+                    envelope2_[v].SetCurve(panel_.curve2);
+                }
+            }
             break;
         case EG1Trigger:
-            envelope_.Reset();
+            panel_.trigger = value;
+            for (size_t v = 0; v < kNumVoices; v++) {
+                if (template_[v] == &panel_) {
+                    envelope_[v].Reset();
+                }
+            }
             break;
         case EG2Trigger:
-            envelope2_.Reset();
+            panel_.trigger2 = value;
+            for (size_t v = 0; v < kNumVoices; v++) {
+                if (template_[v] == &panel_) {
+                    envelope2_[v].Reset();
+                }
+            }
+            break;
+        case Octave:
+        case Pitch:
+            panel_.pitch_offset = p_[Pitch] + p_[Octave] * 12 * 128;
+            break;
+        case EnvRamp:
+            env_ramp_ = value;
+            break;
+        case ControlBlock:  // 0 (default), 8..128
+            if (value == 0) {
+                value = kControlBlockSize;
+            }
+            CONSTRAIN(value, 8, 128);
+            control_block_ = value;
+            updateControlStep();
+            break;
+        case Kit:
+            // The voices keep their drum until they play a note, but
+            // they all go back to the panel when the kit is turned off.
+            kit_on_ = value;
+            if (!kit_on_) {
+                for (size_t v = 0; v < kNumVoices; v++) {
+                    setTemplate(v, panel_);
+                }
+            }
+            break;
+        case Unison:        // 0..8
+        case UnisonDetune:  // 0..100, 0: one copy
+            for (size_t v = 0; v < kNumVoices; v++) {
+                osc_[v].set_unison(p_[Unison], p_[UnisonDetune]);
+            }
             break;
         default:
             break;
@@ -268,6 +643,9 @@ public:
     }
 
     inline int32_t getParameterValue(uint8_t index) const {
+        if (index == CpuLoad) {
+            return governor_.load() / 10;
+        }
         return p_[index];
     }
 
@@ -303,6 +681,9 @@ public:
             }
 
         case VCO_Flatten:
+        case NativeRate:
+        case EnvRamp:
+        case Kit:
             if (value < 2) {
                 return OffOnStr[value];
             } else {
@@ -357,26 +738,24 @@ public:
         (void) tempo;
     }
 
+    // In kit mode the note selects the drum, which plays at the pitch of
+    // its row; GateOn plays the drum of the last note or Note parameter.
     inline void NoteOn(uint8_t note, uint8_t velocity) {
-        pitch_ = note << 7;
-        GateOn(velocity);
+        note_pitch_ = note << 7;
+        strike(allocateVoice(note), note, velocity);
     }
 
     inline void NoteOff(uint8_t note) {
-        (void)note;
-        GateOff();
+        release(note);
     }
 
+    // Plays the last note, or the Note parameter if it was set later.
     inline void GateOn(uint8_t velocity) {
-        amp_ = 1. / 127 * velocity;
-        gate_ += 1;
-        osc_.Strike();
+        strike(allocateVoice(kGateNote), kGateNote, velocity);
     }
 
     inline void GateOff() {
-        if (gate_ > 0 ) {
-            gate_ -= 1;
-        }
+        release(kGateNote);
     }
 
     inline void AllNoteOff() {}
@@ -412,94 +791,663 @@ public:
     }
 
 private:
-    inline int16_t getTrigger(int32_t type) {
+    // A voice for a new note: the one already playing it, else a silent
+    // one if the governor allows one more to sound, else the victim. In
+    // kit mode a silent voice that played the same drum last is preferred:
+    // it strikes without an oscillator reinitialization.
+    inline size_t allocateVoice(uint8_t note) {
+        const VoiceTemplate * t = kit_on_ ? &kit_[(note_pitch_ >> 7) % kKitSize] : &panel_;
+        size_t silent = kNumVoices;
+        for (size_t v = 0; v < kNumVoices; v++) {
+            if (note_[v] == note && gate_[v] > 0) {
+                return v;
+            }
+            if (isSilent(v) && (silent == kNumVoices ||
+                                (template_[v] == t && template_[silent] != t))) {
+                silent = v;
+            }
+        }
+        if (silent < kNumVoices && soundingVoices() < governor_.limit()) {
+            return silent;
+        }
+        return chooseVictim();
+    }
+
+    inline size_t soundingVoices() const {
+        size_t n = 0;
+        for (size_t v = 0; v < kNumVoices; v++) {
+            n += !isSilent(v);
+        }
+        return n;
+    }
+
+    // The quietest released voice, else the oldest one.
+    inline size_t chooseVictim() const {
+        size_t released = kNumVoices;
+        size_t oldest = 0;
+        for (size_t v = 0; v < kNumVoices; v++) {
+            if (isSilent(v)) {
+                continue;
+            }
+            if (gate_[v] == 0 && (released == kNumVoices || gain_lp_[v] < gain_lp_[released])) {
+                released = v;
+            }
+            if (isSilent(oldest) || started_[v] < started_[oldest]) {
+                oldest = v;
+            }
+        }
+        return (released < kNumVoices) ? released : oldest;
+    }
+
+    // The control block in use: the set one, lengthened while the governor
+    // is over budget with nothing to steal. A voice in the middle of a
+    // longer block moves to the new one at once.
+    inline void updateControlStep() {
+        control_coarse_ = governor_.coarse();
+        control_step_ = std::min(control_block_ << control_coarse_, 128);
+        for (size_t v = 0; v < kNumVoices; v++) {
+            if (control_remaining_[v] > control_step_) {
+                control_remaining_[v] = control_step_;
+            }
+        }
+    }
+
+    // Closes the VCA of a voice until its next note, whatever its
+    // envelopes do; the gain smoothing fades it out.
+    inline void steal(size_t v) {
+        gate_[v] = 0;
+        muted_[v] = true;
+    }
+
+    // The gate of the voice starts over from 0 for a new note, also when
+    // the voice is taken from another note, or after the voice was stolen.
+    // The envelopes that follow the gate see it low at once, so that it
+    // rises again at the next block even if it was held: the new note
+    // retriggers them as the baseline's counting gate did.
+    inline void restartGate(size_t v) {
+        gate_[v] = 0;
+        const VoiceTemplate & t = *template_[v];
+        if (t.trigger <= EG_GATEOFF) {
+            envelope_[v].Follow(getTrigger(t.trigger, v));
+        }
+        if (t.trigger2 <= EG_GATEOFF) {
+            envelope2_[v].Follow(getTrigger(t.trigger2, v));
+        }
+    }
+
+    inline void strike(size_t v, uint8_t note, uint8_t velocity) {
+        if (note_[v] != note || muted_[v]) {
+            restartGate(v);
+        }
+        note_[v] = note;
+        pitch_[v] = note_pitch_;
+        if (kit_on_) {
+            const VoiceTemplate & t = kit_[(note_pitch_ >> 7) % kKitSize];
+            setTemplate(v, t);
+            pitch_[v] = t.note_pitch;
+        }
+        started_[v] = ++note_count_;
+        muted_[v] = false;
+        amp_[v] = 1. / 127 * velocity;
+        gate_[v] += 1;
+        osc_[v].Strike();
+        decimator_[v].Reset();
+        // start a control block with the note
+        control_remaining_[v] = 0;
+        note_start_[v] = true;
+    }
+
+    inline void release(uint8_t note) {
+        for (size_t v = 0; v < kNumVoices; v++) {
+            if (note_[v] == note && gate_[v] > 0) {
+                gate_[v] -= 1;
+            }
+        }
+    }
+
+    // Applies the posted events due at frame p of a Render call of the
+    // given length. Returns the frame of the next one, or SIZE_MAX.
+    inline size_t applyEvents(size_t p, size_t frames) {
+        Event e;
+        while (events_.Peek(e)) {
+            const size_t at = std::min<size_t>(e.offset, frames);
+            if (at > p) {
+                return at;
+            }
+            events_.Pop(e);
+            switch (e.type) {
+            case EVENT_PARAM:
+                // clear the flag first: a write after this queues a new event
+                flags_[e.a >> 5].fetch_and(~(1u << (e.a & 31)), std::memory_order_acq_rel);
+                setParameter(e.a, posted_[e.a].load(std::memory_order_relaxed));
+                break;
+            case EVENT_NOTE_ON:
+                NoteOn(e.a, e.b);
+                break;
+            case EVENT_NOTE_OFF:
+                NoteOff(e.a);
+                break;
+            case EVENT_GATE_ON:
+                GateOn(e.b);
+                break;
+            case EVENT_GATE_OFF:
+                GateOff();
+                break;
+            case EVENT_ALL_NOTE_OFF:
+                AllNoteOff();
+                break;
+            case EVENT_RESET:
+                Reset();
+                break;
+            default:
+                break;
+            }
+        }
+        return SIZE_MAX;
+    }
+
+    inline int16_t getTrigger(int32_t type, size_t v) {
+        const braids::LinEnvelope & env_a = envelope_[v];
+        const braids::LinEnvelope & env_b = envelope2_[v];
         int16_t trigger;
         switch(type) {
         case EG_GATEOFF:
-            trigger = -gate_;
+            trigger = -gate_[v];
             break;
         case EG_A_END:
-            trigger = (envelope_.segment() == braids::EnvelopeSegment::ENV_SEGMENT_DEAD);
+            trigger = (env_a.segment() == braids::EnvelopeSegment::ENV_SEGMENT_DEAD);
             break;
         case EG_A_ATTACK_END:
-            trigger = (envelope_.segment() == braids::EnvelopeSegment::ENV_SEGMENT_DECAY);
+            trigger = (env_a.segment() == braids::EnvelopeSegment::ENV_SEGMENT_DECAY);
             break;
         case EG_B_END:
-            trigger = (envelope2_.segment() == braids::EnvelopeSegment::ENV_SEGMENT_DEAD);
+            trigger = (env_b.segment() == braids::EnvelopeSegment::ENV_SEGMENT_DEAD);
             break;
         case EG_B_ATTACK_END:
-            trigger = (envelope2_.segment() == braids::EnvelopeSegment::ENV_SEGMENT_DECAY);
+            trigger = (env_b.segment() == braids::EnvelopeSegment::ENV_SEGMENT_DECAY);
             break;
         case EG_A_DCY_B_END:
-            trigger = (envelope_.segment() == braids::EnvelopeSegment::ENV_SEGMENT_DECAY) * (envelope2_.segment() == braids::EnvelopeSegment::ENV_SEGMENT_DEAD);
+            trigger = (env_a.segment() == braids::EnvelopeSegment::ENV_SEGMENT_DECAY) * (env_b.segment() == braids::EnvelopeSegment::ENV_SEGMENT_DEAD);
             break;
         case EG_B_DCY_A_END:
-            trigger = (envelope2_.segment() == braids::EnvelopeSegment::ENV_SEGMENT_DECAY) * (envelope_.segment() == braids::EnvelopeSegment::ENV_SEGMENT_DEAD);
+            trigger = (env_b.segment() == braids::EnvelopeSegment::ENV_SEGMENT_DECAY) * (env_a.segment() == braids::EnvelopeSegment::ENV_SEGMENT_DEAD);
             break;
         default:
-            trigger = gate_;
+            trigger = gate_[v];
         }
         return trigger;
     }
 
-    inline uint32_t getModVal(int32_t src, uint32_t env, uint32_t env2) {
-        int32_t env_val;
-        switch(src) {
-        case SRC_EG1:
-            env_val = env;
-            break;
-        case SRC_EG2:
-            env_val = env2;
-            break;
-        case SRC_SUM:
-            env_val = (env + env2) / 2;
-            break;
-        case SRC_MUL:
-            env_val = (env * env2) >> 16;
-            break;
-        case SRC_A_MINUS_B:
-            env_val = env - env2;
-            break;
-        case SRC_B_MINUS_A:
-            env_val = env2 - env;
-            break;
-        case SRC_A_MINUS_AB:
-            env_val = env - (env * env2 >> 16);
-            break;
-        case SRC_B_MINUS_AB:
-            env_val = env2 - (env * env2 >> 16);
-            break;
-        case SRC_A_PLUS_B_MINUS_AB:
-            env_val = env + env2 - (env * env2 >> 16);
-            break;
-        case SRC_A_PLUS_B_MINUS_2AB:
-            env_val = env + env2 - (env * env2 >> 15);
-            break;
-        default:
-            break;
+    // Rebuilds the routing of one destination from its ModSrc/ModInt
+    // parameters. Called from setParameter, so Render does not switch on
+    // the sources.
+    inline void updateModRoute(ModDest dest) {
+        static const Params src_param[MODDESTCOUNT] = {
+            ModSrcTimbre, ModSrcColor, ModSrcFM, ModSrcVCA
+        };
+        static const Params int_param[MODDESTCOUNT] = {
+            ModIntTimbre, ModIntColor, ModIntFM, ModIntVCA
+        };
+        setModRoute(panel_, dest, p_[src_param[dest]], p_[int_param[dest]]);
+    }
+
+    static inline void setModRoute(VoiceTemplate & t, ModDest dest, int32_t src,
+                                   int32_t intensity) {
+        t.mod_route[dest] = (src >= 0 && src < MODSRCCOUNT) ? mod_sources[src] : ModSource();
+        // the VCA intensity also sets the unmodulated gain, see updateControl
+        t.mod_int[dest] = (dest == DEST_VCA) ? intensity : clipminmax(0, intensity, 31);
+    }
+
+    // Param1/Param2 -256..255 to timbre and color, which must be 0..32767.
+    static inline int16_t toTimbre(int32_t value) {
+        CONSTRAIN(value, -2560, 256);
+        return (value + 256) << 6;
+    }
+
+    // The template of a row laid out like Presets.
+    static inline void buildTemplate(VoiceTemplate & t, const int16_t * row) {
+        t.note_pitch = clipminmax(0, row[Note], 127) << 7;
+        t.shape = clipminmax(0, row[Shape], 46);
+        t.timbre = toTimbre(row[Param1]);
+        t.color = toTimbre(row[Param2]);
+        t.curve = row[EG1Curve] << 9;
+        t.trigger = row[EG1Trigger];
+        t.attack = row[Attack];
+        t.decay = row[Decay];
+        t.curve2 = row[EG2Curve] << 9;
+        t.trigger2 = row[EG2Trigger];
+        t.attack2 = row[Attack2];
+        t.decay2 = row[Decay2];
+        t.pitch_offset = row[Pitch] + row[Octave] * 12 * 128;
+        setModRoute(t, DEST_VCA, row[ModSrcVCA], row[ModIntVCA]);
+        setModRoute(t, DEST_FM, row[ModSrcFM], row[ModIntFM]);
+        setModRoute(t, DEST_TIMBRE, row[ModSrcTimbre], row[ModIntTimbre]);
+        setModRoute(t, DEST_COLOR, row[ModSrcColor], row[ModIntColor]);
+    }
+
+    // Makes a voice play with t. Switching costs the settings of the
+    // oscillator and the envelopes; the rest is read through the pointer.
+    inline void setTemplate(size_t v, const VoiceTemplate & t) {
+        const VoiceTemplate & old = *template_[v];
+        if (&t == &old) {
+            return;
+        }
+        template_[v] = &t;
+        osc_[v].set_shape(static_cast<braids::MacroOscillatorShape>(t.shape));
+        envelope_[v].Update(t.attack, t.decay);
+        envelope_[v].SetCurve(t.curve);
+        envelope2_[v].Update(t.attack2, t.decay2);
+        envelope2_[v].SetCurve(t.curve2);
+        if (t.trigger != old.trigger) {
+            envelope_[v].Reset();
         }
+        if (t.trigger2 != old.trigger2) {
+            envelope2_[v].Reset();
+        }
+    }
+
+    static inline uint32_t getModVal(const VoiceTemplate & t, ModDest dest, uint32_t env,
+                                     uint32_t env2, uint32_t env_mul16, uint32_t env_mul15) {
+        const ModSource & m = t.mod_route[dest];
+        int32_t env_val = ((m.env * static_cast<int32_t>(env) +
+                            m.env2 * static_cast<int32_t>(env2)) >> m.shift) +
+            m.mul16 * static_cast<int32_t>(env_mul16) +
+            m.mul15 * static_cast<int32_t>(env_mul15);
         CONSTRAIN(env_val, 0, 0xffff);
         return env_val;
     }
 
-    std::atomic_uint_fast32_t flags_;
+    // Envelopes and modulation, once per control block. The envelopes and
+    // the VCO drift advance by the block size, so their timing does not
+    // depend on it.
+    inline void updateControl(size_t v, int16_t env1trigger, int16_t env2trigger) {
+        const VoiceTemplate & t = *template_[v];
+        uint32_t env1 = envelope_[v].Render(env1trigger, control_step_);
+        uint32_t env2 = envelope2_[v].Render(env2trigger, control_step_);
+        RENDER_STATS_MARK(stats_, STAGE_ENVELOPE);
+        uint32_t env_val;
+        uint32_t env_int;
+
+        // products of the envelopes, shared by all the destinations
+        uint32_t env_mul16 = env1 * env2 >> 16;
+        uint32_t env_mul15 = env1 * env2 >> 15;
+
+        // Set timbre and color: parameter value + internal modulation.
+        int32_t timbre = t.timbre;
+        env_val = getModVal(t, DEST_TIMBRE, env1, env2, env_mul16, env_mul15);
+        env_int = t.mod_int[DEST_TIMBRE];
+        timbre += env_val * env_int >> 6;
+        CONSTRAIN(timbre, 0, 32767);
+
+        int32_t color = t.color;
+        env_val = getModVal(t, DEST_COLOR, env1, env2, env_mul16, env_mul15);
+        env_int = t.mod_int[DEST_COLOR];
+        color += env_val * env_int >> 6;
+        CONSTRAIN(color, 0, 32767);
+
+        int32_t pitch = pitch_[v];
+        env_val = getModVal(t, DEST_FM, env1, env2, env_mul16, env_mul15);
+        env_int = t.mod_int[DEST_FM];
+        pitch += t.pitch_offset;
+        pitch += env_val * env_int >> 7;
+
+        env_val = getModVal(t, DEST_VCA, env1, env2, env_mul16, env_mul15);
+        int32_t gain = (env_val * t.mod_int[DEST_VCA] >> 5);
+        gain += (31 - t.mod_int[DEST_VCA]) * (gate_[v] > 0) << 10;
+        if (muted_[v]) {
+            gain = 0;
+        }
+        RENDER_STATS_MARK(stats_, STAGE_MODULATION);
+
+        // the jitter source is clocked every 24 samples
+        for (jitter_count_[v] += control_step_; jitter_count_[v] >= 24; jitter_count_[v] -= 24) {
+            jitter_[v] = jitter_source_[v].Render(p_[VCO_Drift]);
+        }
+        pitch += jitter_[v];
+        RENDER_STATS_MARK(stats_, STAGE_JITTER);
+
+        if (pitch > 16383) {
+            pitch = 16383;
+        } else if (pitch < 0) {
+            pitch = 0;
+        }
+
+        // With EnvRamp the values computed here are reached at the end of
+        // the control block, otherwise they apply from its start.
+        if (env_ramp_) {
+            if (note_start_[v]) {
+                pitch_ramp_[v].Jump(pitch);
+            } else {
+                pitch_ramp_[v].Target(pitch, control_step_);
+            }
+            timbre_ramp_[v].Target(timbre, control_step_);
+            color_ramp_[v].Target(color, control_step_);
+            gain_ramp_[v].Target(gain, control_step_);
+        } else {
+            pitch_ramp_[v].Jump(pitch);
+            timbre_ramp_[v].Jump(timbre);
+            color_ramp_[v].Jump(color);
+            gain_ramp_[v].Jump(gain);
+        }
+        note_start_[v] = false;
+        RENDER_STATS_END_BLOCK(stats_);
+    }
+
+    typedef void (Synth::*BlockKernel)(size_t v, int16_t * buf, float * out, size_t size,
+                                       int32_t gain, uint16_t decimation_factor,
+                                       uint16_t bit_mask, uint16_t signature);
+
+    // Parameters of Render that only change with events.
+    struct RenderSettings {
+        int16_t env1trigger[kNumVoices];
+        int16_t env2trigger[kNumVoices];
+        uint16_t decimation_factor;
+        int32_t rate_pitch_offset;
+        bool native_rate;
+        uint16_t bit_mask;
+        uint16_t signature;
+        // the rest of the signal path, specialized until the next event,
+        // storing and accumulating
+        BlockKernel kernel[2];
+        BlockKernel held_kernel[2];
+    };
+
+    // Renders one voice from the current frame to the next event, into
+    // out or added to it.
+    inline void renderVoice(size_t v, const RenderSettings & rs, float * __restrict out_p,
+                            size_t frames, bool accumulate) {
+        const int bufsize = 24; // size of temp_buffer in macro_oscillator.h
+        int16_t buf[bufsize] = {};
+        const uint8_t sync[bufsize] = {};
+        UnisonOscillator & osc = osc_[v];
+        const BlockKernel kernel = rs.kernel[accumulate];
+        const BlockKernel held_kernel = rs.held_kernel[accumulate];
+        for (size_t p = 0; p < frames; ) {
+            if (control_remaining_[v] == 0) {
+                updateControl(v, rs.env1trigger[v], rs.env2trigger[v]);
+                control_remaining_[v] = control_step_;
+            }
+
+            // The oscillator renders at most bufsize samples at a time; the
+            // control values stay the same until the control block is over,
+            // which can be in a later call. The oscillator takes pitch,
+            // timbre and color once per call, so while they ramp it renders
+            // kRampChunk samples at a time to follow them.
+            const bool ramping = pitch_ramp_[v].ramping() || timbre_ramp_[v].ramping()
+                || color_ramp_[v].ramping();
+            size_t r_size = std::min<size_t>(std::min<size_t>(ramping ? kRampChunk : bufsize,
+                                                              control_remaining_[v]),
+                                             frames - p);
+            int32_t pitch = pitch_ramp_[v].value();
+            int32_t gain = gain_ramp_[v].value();
+            osc.set_parameters(timbre_ramp_[v].value(), color_ramp_[v].value());
+            if (rs.native_rate && pitch + rs.rate_pitch_offset <= 16383) {
+                // Render only the samples the reducer holds, at the reduced
+                // rate. Time constants inside the oscillator (e.g. the decay
+                // of the percussive shapes) stretch by the decimation factor.
+                int16_t held[bufsize];
+                size_t n = decimator_[v].Takes(r_size, rs.decimation_factor);
+                osc.set_pitch(pitch + rs.rate_pitch_offset);
+                if (n) {
+                    osc.Render(sync, held, n);
+                }
+                RENDER_STATS_MARK(stats_, STAGE_OSCILLATOR);
+                decimator_[v].Hold(held, buf, r_size, rs.decimation_factor, rs.bit_mask);
+                (this->*held_kernel)(v, buf, out_p, r_size, gain,
+                                     rs.decimation_factor, rs.bit_mask, rs.signature);
+            } else {
+                osc.set_pitch(pitch);
+                osc.Render(sync, buf, r_size);
+                RENDER_STATS_MARK(stats_, STAGE_OSCILLATOR);
+                (this->*kernel)(v, buf, out_p, r_size, gain,
+                                rs.decimation_factor, rs.bit_mask, rs.signature);
+            }
+            pitch_ramp_[v].Advance(r_size);
+            timbre_ramp_[v].Advance(r_size);
+            color_ramp_[v].Advance(r_size);
+            gain_ramp_[v].Advance(r_size);
+            out_p += r_size * 2;
+            p += r_size;
+            control_remaining_[v] -= r_size;
+        }
+    }
+
+    // Signal path after the oscillator, without the stages that are
+    // inactive: at Bits 16, Rate 48K and Signature 0 (all the presets) the
+    // block is only scaled and copied to the output.
+    template <bool decimate, bool reduce_bits, bool warp, bool accumulate>
+    void renderBlock(size_t v, int16_t * buf, float * out, size_t size, int32_t gain,
+                     uint16_t decimation_factor, uint16_t bit_mask, uint16_t signature) {
+        // Sample rate and bit reduction.
+        if (decimate) {
+            decimator_[v].Process(buf, size, decimation_factor, bit_mask);
+        } else if (reduce_bits) {
+            const size_t size8 = size & ~7;
+            const simd::i16x8 mask = simd::dup_s16(bit_mask);
+            for (size_t i = 0; i < size8; i += 8) {
+                simd::store(buf + i, simd::bit_and(simd::load(buf + i), mask));
+            }
+            for (size_t i = size8; i < size; i++) {
+                buf[i] &= bit_mask;
+            }
+        }
+        RENDER_STATS_MARK(stats_, STAGE_CRUSHER);
+
+        // VCA and waveshaper, copied or added to the output buffer.
+        renderOutput<warp, accumulate>(v, buf, out, size, gain, signature);
+        RENDER_STATS_MARK(stats_, STAGE_OUTPUT);
+    }
+
+    inline void readSettings(RenderSettings & rs) {
+        for (size_t v = 0; v < kNumVoices; v++) {
+            rs.env1trigger[v] = getTrigger(template_[v]->trigger, v);
+            rs.env2trigger[v] = getTrigger(template_[v]->trigger2, v);
+        }
+        rs.decimation_factor = decimation_factors[p_[SampleRate]];
+        rs.rate_pitch_offset = decimation_pitch_offsets[p_[SampleRate]];
+        rs.native_rate = p_[NativeRate] && rs.decimation_factor > 1;
+        rs.bit_mask = bit_reduction_masks[p_[Resolution]];
+        rs.signature = p_[Signature] * p_[Signature] * 4095;
+        for (int accumulate = 0; accumulate < 2; accumulate++) {
+            rs.kernel[accumulate] = selectKernel(rs.decimation_factor > 1, rs.bit_mask != 0xffff,
+                                                 rs.signature != 0, accumulate);
+            rs.held_kernel[accumulate] = selectKernel(false, false, rs.signature != 0, accumulate);
+        }
+    }
+
+    // The VCA of the voice is closed.
+    inline bool isSilent(size_t v) const {
+        return gate_[v] == 0 && gain_lp_[v] == 0 &&
+            gain_ramp_[v].value() == 0 && gain_ramp_[v].increment() == 0 &&
+            (muted_[v] ||
+             (envelope_[v].segment() == braids::EnvelopeSegment::ENV_SEGMENT_DEAD &&
+              envelope2_[v].segment() == braids::EnvelopeSegment::ENV_SEGMENT_DEAD));
+    }
+
+    // ...and stays closed until a gate or an envelope trigger: the
+    // oscillator and the envelopes can be left alone.
+    inline bool isIdle(size_t v, const RenderSettings & rs) const {
+        return isSilent(v) && (muted_[v] ||
+            (!envelope_[v].triggers(rs.env1trigger[v]) && !envelope2_[v].triggers(rs.env2trigger[v])));
+    }
+
+    // Output of renderOutput for a silent VCA: zero, unless the signature
+    // waveshaper adds an offset.
+    inline void renderSilence(size_t v, float * out, size_t size, uint16_t signature,
+                              bool accumulate) {
+        const int16_t mixed = Mix(int16_t(0), ws_.Transform(0), signature);
+        const float level = mixed * (amp_[v] / 32768.f);
+        for (size_t i = 0; i < size; i++, out += 2) {
+            simd::store_stereo(out, accumulate ? out[0] + level : level);
+        }
+    }
+
+    static inline BlockKernel selectKernel(bool decimate, bool reduce_bits, bool warp,
+                                           bool accumulate) {
+        static const BlockKernel kernels[16] = {
+            &Synth::renderBlock<false, false, false, false>,
+            &Synth::renderBlock<false, false, false, true>,
+            &Synth::renderBlock<false, false, true, false>,
+            &Synth::renderBlock<false, false, true, true>,
+            &Synth::renderBlock<false, true, false, false>,
+            &Synth::renderBlock<false, true, false, true>,
+            &Synth::renderBlock<false, true, true, false>,
+            &Synth::renderBlock<false, true, true, true>,
+            &Synth::renderBlock<true, false, false, false>,
+            &Synth::renderBlock<true, false, false, true>,
+            &Synth::renderBlock<true, false, true, false>,
+            &Synth::renderBlock<true, false, true, true>,
+            &Synth::renderBlock<true, true, false, false>,
+            &Synth::renderBlock<true, true, false, true>,
+            &Synth::renderBlock<true, true, true, false>,
+            &Synth::renderBlock<true, true, true, true>,
+        };
+        return kernels[decimate << 3 | reduce_bits << 2 | warp << 1 | accumulate];
+    }
+
+    // VCA, signature waveshaper and conversion to interleaved stereo float,
+    // 8 samples per iteration. Only the gain smoothing and the waveshaper
+    // table lookup remain scalar; the latter is left out when signature is
+    // 0 since Mix() then ignores the warped sample. With accumulate the
+    // result is added to out, for the voices after the first one.
+    template <bool warp, bool accumulate>
+    fast_inline void renderOutput(size_t v, const int16_t * buf, float * __restrict out,
+                                  size_t size, int32_t gain, uint16_t signature) {
+        const int bufsize = 24;
+        const ControlRamp & gain_ramp = gain_ramp_[v];
+        uint16_t & gain_lp = gain_lp_[v];
+        int32_t gains[bufsize];
+        int16_t sample[bufsize];
+        int16_t warped[bufsize];
+
+        bool ramp;
+        if (env_ramp_) {
+            // linear ramp towards the end of the control block
+            static const int32_t lane[4] = { 0, 1, 2, 3 };
+            const simd::i32x4 inc = simd::dup_s32(gain_ramp.increment());
+            const simd::i32x4 lane_inc = simd::mul(simd::load(lane), inc);
+            for (size_t i = 0; i < size; i += 4) {
+                const simd::i32x4 g = simd::add(simd::dup_s32(gain_ramp.at(i)), lane_inc);
+                simd::store(gains + i, simd::shr(g, ControlRamp::kShift));
+            }
+            gain_lp = gain_ramp.at(size) >> ControlRamp::kShift;
+            ramp = true;
+        } else {
+            ramp = ((gain - gain_lp) >> 4) != 0;
+            if (ramp) {
+                for (size_t i = 0; i < size; i++) {
+                    gains[i] = gain_lp;
+                    gain_lp += (gain - gain_lp) >> 4;
+                }
+            }
+        }
+
+        const size_t size8 = size & ~7;
+        const simd::i32x4 gain_v = simd::dup_s32(gain_lp);
+        for (size_t i = 0; i < size8; i += 8) {
+            const simd::i16x8 in = simd::load(buf + i);
+            const simd::i32x4 g_lo = ramp ? simd::load(gains + i) : gain_v;
+            const simd::i32x4 g_hi = ramp ? simd::load(gains + i + 4) : gain_v;
+            simd::store(sample + i, simd::narrow_sat(
+                simd::shr(simd::mul(simd::widen_lo(in), g_lo), 16),
+                simd::shr(simd::mul(simd::widen_hi(in), g_hi), 16)));
+        }
+        for (size_t i = size8; i < size; i++) {
+            sample[i] = buf[i] * (ramp ? gains[i] : gain_lp) >> 16;
+        }
+
+        if (warp) {
+            for (size_t i = 0; i < size; i++) {
+                warped[i] = ws_.Transform(sample[i]);
+            }
+        }
+
+        // Mix(a, b, balance) = (a * (65535 - balance) + b * balance) >> 16
+        const simd::i32x4 dry = simd::dup_s32(65535 - signature);
+        const simd::i32x4 wet = simd::dup_s32(signature);
+        const simd::f32x4 scale = simd::dup_f32(amp_[v] / 32768.f);
+        for (size_t i = 0; i < size8; i += 8, out += 16) {
+            const simd::i16x8 a = simd::load(sample + i);
+            simd::i32x4 lo = simd::mul(simd::widen_lo(a), dry);
+            simd::i32x4 hi = simd::mul(simd::widen_hi(a), dry);
+            if (warp) {
+                const simd::i16x8 b = simd::load(warped + i);
+                lo = simd::add(lo, simd::mul(simd::widen_lo(b), wet));
+                hi = simd::add(hi, simd::mul(simd::widen_hi(b), wet));
+            }
+            const simd::f32x4 lo_f = simd::mul(simd::to_f32(simd::shr(lo, 16)), scale);
+            const simd::f32x4 hi_f = simd::mul(simd::to_f32(simd::shr(hi, 16)), scale);
+            if (accumulate) {
+                simd::f32x4 l, r;
+                simd::load_interleaved(out, l, r);
+                simd::store_interleaved(out, simd::add(l, lo_f), simd::add(r, lo_f));
+                simd::load_interleaved(out + 8, l, r);
+                simd::store_interleaved(out + 8, simd::add(l, hi_f), simd::add(r, hi_f));
+            } else {
+                simd::store_interleaved(out, lo_f, lo_f);
+                simd::store_interleaved(out + 8, hi_f, hi_f);
+            }
+        }
+        for (size_t i = size8; i < size; i++, out += 2) {
+            const int16_t mixed = warp ? Mix(sample[i], warped[i], signature)
+                                       : Mix(sample[i], int16_t(0), uint16_t(0));
+            const float x = amp_[v] * mixed / 32768.f;
+            simd::store_stereo(out, accumulate ? out[0] + x : x);
+        }
+    }
+
+    // pending parameter events, one bit per parameter
+    std::atomic_uint_fast32_t flags_[kParamFlagWords];
+    std::atomic<int32_t> posted_[PARAMCOUNT];
+    EventQueue<Event, kEventQueueSize> events_;
 
     int32_t p_[PARAMCOUNT];
     uint8_t preset_;
 
-    braids::MacroOscillator osc_;
-    braids::LinEnvelope envelope_;
-    braids::LinEnvelope envelope2_;
     braids::SignatureWaveshaper ws_;
-    braids::VcoJitterSource jitter_source_;
-
-    int16_t pitch_;
-    int16_t timbre_;
-    int16_t color_;
-    float amp_;
-    int16_t gate_;
-
-    uint16_t gain_lp_;
+    LoadGovernor<kNumVoices> governor_;
+    VoiceTemplate panel_;
+    VoiceTemplate kit_[kKitSize];
+    bool kit_on_;
+
+    int16_t note_pitch_;
+    uint16_t control_block_;
+    uint16_t control_step_;     // control_block_ lengthened by the governor
+    uint32_t control_coarse_;   // governor_.coarse() in control_step_
+    bool env_ramp_;
+    uint32_t note_count_;
+    uint32_t random_state_;
+
+    // voices, one array per member
+    UnisonOscillator osc_[kNumVoices];
+    braids::LinEnvelope envelope_[kNumVoices];
+    braids::LinEnvelope envelope2_[kNumVoices];
+    braids::VcoJitterSource jitter_source_[kNumVoices];
+    Decimator decimator_[kNumVoices];
+
+    int16_t pitch_[kNumVoices];
+    float amp_[kNumVoices];
+    int16_t gate_[kNumVoices];
+    uint8_t note_[kNumVoices];
+    uint32_t started_[kNumVoices];  // note_count_ at the strike
+    bool muted_[kNumVoices];        // stolen, until the next strike
+    const VoiceTemplate * template_[kNumVoices];  // &panel_ or a drum of kit_
+
+    uint16_t gain_lp_[kNumVoices];
+
+    // control block
+    uint16_t control_remaining_[kNumVoices];
+    ControlRamp pitch_ramp_[kNumVoices];
+    ControlRamp timbre_ramp_[kNumVoices];
+    ControlRamp color_ramp_[kNumVoices];
+    ControlRamp gain_ramp_[kNumVoices];
+    bool note_start_[kNumVoices];
+    int16_t jitter_[kNumVoices];
+    uint16_t jitter_count_[kNumVoices];
+
+#ifdef LILLIAN_RENDER_STATS
+    RenderStats stats_;
+#endif
 
     /* Private Methods. */
     /* Constants. */
@@ -687,4 +1635,22 @@ private:
          0, 0, 6, 5},
 
     };
+
+    // The drum kit: the preset each note of the octave plays, and at which
+    // note. The kit follows the presets; the notes spread the repeated
+    // ones like the toms of General MIDI notes 36 to 47.
+    const KitSlot KitSlots[kKitSize] = {
+        {5, 36},    // C: PhazBass
+        {7, 72},    // C#: Robot
+        {2, 50},    // D: BrokenAI
+        {8, 64},    // D#: Laughing
+        {4, 55},    // E: Shaku
+        {1, 41},    // F: SpcVoice
+        {3, 84},    // F#: SuperSaw
+        {0, 45},    // G: Init
+        {6, 72},    // G#: Maj7+3rd
+        {1, 50},    // A: SpcVoice
+        {3, 79},    // A#: SuperSaw
+        {0, 55},    // B: Init
+    };
 };
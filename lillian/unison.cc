@@ -0,0 +1,343 @@
+/*
+ *  File: unison.cc
+ *
+ *  unison of detuned oscillator copies
+ *
+ *  The packed kernels are ports of the DigitalOscillator kernels of the
+ *  same name (digital_oscillator.cc) that run all the copies sample by
+ *  sample. Each copy computes exactly what a DigitalOscillator would at
+ *  its pitch, and the sum of the copies is kept in 32 bits until the
+ *  final gain. They have no sync input: Render hands the blocks with a
+ *  sync pulse to the copies' own MacroOscillators.
+ *
+ */
+
+#include "unison.h"
+
+#include <cstring>
+
+#include "stmlib/utils/dsp.h"
+#include "braids/parameter_interpolation.h"
+#include "braids/resources.h"
+
+#include "simd.h"
+
+namespace braids {
+// defined in digital_oscillator.cc
+void WavetableWaves(int16_t parameter_0, int16_t parameter_1,
+                    const uint8_t ** wave, uint32_t * wave_pointer);
+}
+
+using namespace braids;
+using namespace stmlib;
+
+static const uint16_t kPitchTableStart = 128 * 128;
+static const uint16_t kOctave = 12 * 128;
+
+// 1/sqrt(copies), in 1/4096
+static const int32_t kUnisonGain[] = { 4096, 4096, 2896, 2365, 2048, 1832, 1672, 1548, 1448 };
+static_assert(UnisonOscillator::kMaxUnison < sizeof(kUnisonGain) / sizeof(kUnisonGain[0]),
+              "no gain for LILLIAN_UNISON copies");
+
+static const uint32_t kPhaseReset[] = {
+    0,
+    0x80000000,
+    0x40000000,
+    0x80000000
+};
+
+// DigitalOscillator::ComputePhaseIncrement, which is private.
+static uint32_t ComputePhaseIncrement(int16_t midi_pitch) {
+    if (midi_pitch >= kPitchTableStart) {
+        midi_pitch = kPitchTableStart - 1;
+    }
+    int32_t ref_pitch = midi_pitch;
+    ref_pitch -= kPitchTableStart;
+    size_t num_shifts = 0;
+    while (ref_pitch < 0) {
+        ref_pitch += kOctave;
+        ++num_shifts;
+    }
+    uint32_t a = lut_oscillator_increments[ref_pitch >> 4];
+    uint32_t b = lut_oscillator_increments[(ref_pitch >> 4) + 1];
+    uint32_t phase_increment = a + (static_cast<int32_t>(b - a) * (ref_pitch & 0xf) >> 4);
+    phase_increment >>= num_shifts;
+    return phase_increment;
+}
+
+// true if sync has a pulse in its first size samples
+static inline bool synced(const uint8_t * sync, size_t size) {
+    uint8_t any = 0;
+    for (size_t i = 0; i < size; i++) {
+        any |= sync[i];
+    }
+    return any != 0;
+}
+
+// phase[l] += increment[l] for lanes 0..n-1, n a multiple of 4
+static inline void advance(uint32_t * phase, const uint32_t * increment, size_t n) {
+    for (size_t l = 0; l < n; l += 4) {
+        int32_t * p = reinterpret_cast<int32_t *>(phase + l);
+        const int32_t * i = reinterpret_cast<const int32_t *>(increment + l);
+        simd::store(p, simd::add(simd::load(p), simd::load(i)));
+    }
+}
+
+void UnisonOscillator::Render(const uint8_t * sync, int16_t * buffer, size_t size) {
+    if (lanes_ == 1) {
+        lane_[0].Render(sync, buffer, size);
+        return;
+    }
+    int32_t mix[kBlockSize];
+    if (packed(shape_) && !synced(sync, size)) {
+        renderPacked(mix, size);
+    } else {
+        renderSequential(sync, mix, size);
+    }
+
+    const simd::i32x4 gain = simd::dup_s32(kUnisonGain[lanes_]);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        simd::store(buffer + i, simd::narrow_sat(
+            simd::shr(simd::mul(simd::load(mix + i), gain), 12),
+            simd::shr(simd::mul(simd::load(mix + i + 4), gain), 12)));
+    }
+    for (; i < size; i++) {
+        int32_t sample = mix[i] * kUnisonGain[lanes_] >> 12;
+        CONSTRAIN(sample, -32768, 32767);
+        buffer[i] = sample;
+    }
+}
+
+void UnisonOscillator::renderSequential(const uint8_t * sync, int32_t * mix, size_t size) {
+    int16_t buf[kBlockSize];
+    std::memset(mix, 0, size * sizeof(mix[0]));
+    for (size_t l = 0; l < lanes_; l++) {
+        int32_t pitch = pitch_ + offset_[l];
+        CONSTRAIN(pitch, 0, 16383);
+        lane_[l].set_pitch(pitch);
+        lane_[l].set_parameters(parameter_[0], parameter_[1]);
+        lane_[l].Render(sync, buf, size);
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            const simd::i16x8 in = simd::load(buf + i);
+            simd::store(mix + i, simd::add(simd::load(mix + i), simd::widen_lo(in)));
+            simd::store(mix + i + 4, simd::add(simd::load(mix + i + 4), simd::widen_hi(in)));
+        }
+        for (; i < size; i++) {
+            mix[i] += buf[i];
+        }
+    }
+    lane_[0].set_pitch(pitch_);
+}
+
+void UnisonOscillator::renderPacked(int32_t * mix, size_t size) {
+    if (reset_) {
+        // DigitalOscillator::Init on a change of shape; the ring mod
+        // kernel keeps its phase a quarter turn ahead of the oscillator's.
+        const uint32_t phase = (shape_ == MACRO_OSC_SHAPE_TRIPLE_RING_MOD) ? 1L << 30 : 0;
+        previous_parameter_[0] = previous_parameter_[1] = 0;
+        for (size_t l = 0; l < kLaneStride; l++) {
+            lane_pitch_[l] = 0;
+            phase_[l] = phase;
+            phase_increment_[l] = 0;
+            modulator_phase_[l] = 0;
+            modulator_phase_2_[l] = 0;
+            modulator_phase_increment_[l] = 0;
+            integrator_[l] = 0;
+            polarity_[l] = 0;
+        }
+        reset_ = false;
+    }
+    for (size_t l = 0; l < lanes_; l++) {
+        int32_t pitch = pitch_ + offset_[l];
+        CONSTRAIN(pitch, 0, 16383);
+        // DigitalOscillator::set_pitch smooths the high notes
+        if (lane_pitch_[l] > (90 << 7) && pitch > (90 << 7)) {
+            lane_pitch_[l] = (lane_pitch_[l] + pitch) >> 1;
+        } else {
+            lane_pitch_[l] = pitch;
+        }
+        phase_increment_[l] = ComputePhaseIncrement(lane_pitch_[l]);
+    }
+
+    switch (shape_) {
+    case MACRO_OSC_SHAPE_TRIPLE_RING_MOD:
+        renderTripleRingMod(mix, size);
+        break;
+    case MACRO_OSC_SHAPE_FM:
+        renderFm(mix, size);
+        break;
+    case MACRO_OSC_SHAPE_WAVETABLES:
+        renderWavetables(mix, size);
+        break;
+    default:
+        renderDigitalFilter(mix, size);
+        break;
+    }
+}
+
+void UnisonOscillator::renderTripleRingMod(int32_t * mix, size_t size) {
+    const size_t n = (lanes_ + 3) & ~size_t(3);
+    uint32_t increment_1[kLaneStride] = {};
+    uint32_t increment_2[kLaneStride] = {};
+    for (size_t l = 0; l < lanes_; l++) {
+        increment_1[l] = ComputePhaseIncrement(lane_pitch_[l] + ((parameter_[0] - 16384) >> 2));
+        increment_2[l] = ComputePhaseIncrement(lane_pitch_[l] + ((parameter_[1] - 16384) >> 2));
+    }
+    for (size_t i = 0; i < size; i++) {
+        advance(phase_, phase_increment_, n);
+        advance(modulator_phase_, increment_1, n);
+        advance(modulator_phase_2_, increment_2, n);
+        int32_t sum = 0;
+        for (size_t l = 0; l < lanes_; l++) {
+            int16_t result = Interpolate824(wav_sine, phase_[l]);
+            result = result * Interpolate824(wav_sine, modulator_phase_[l]) >> 16;
+            result = result * Interpolate824(wav_sine, modulator_phase_2_[l]) >> 16;
+            sum += Interpolate88(ws_moderate_overdrive, result + 32768);
+        }
+        mix[i] = sum;
+    }
+}
+
+void UnisonOscillator::renderDigitalFilter(int32_t * mix, size_t size) {
+    const uint8_t filter_type = shape_ - MACRO_OSC_SHAPE_DIGITAL_FILTER_LP;
+    const size_t n = (lanes_ + 3) & ~size_t(3);
+    uint32_t increment_increment[kLaneStride];
+    for (size_t l = 0; l < lanes_; l++) {
+        int16_t shifted_pitch = lane_pitch_[l] + ((parameter_[0] - 2048) >> 1);
+        if (shifted_pitch > 16383) {
+            shifted_pitch = 16383;
+        }
+        const uint32_t target_increment = ComputePhaseIncrement(shifted_pitch);
+        const uint32_t increment = modulator_phase_increment_[l];
+        increment_increment[l] = increment < target_increment
+            ? (target_increment - increment) / size
+            : ~((increment - target_increment) / size);
+    }
+    const uint16_t balance = (parameter_[1] < 16384 ? parameter_[1] : ~parameter_[1]) << 2;
+
+    for (size_t i = 0; i < size; i++) {
+        advance(phase_, phase_increment_, n);
+        int32_t sum = 0;
+        for (size_t l = 0; l < lanes_; l++) {
+            const uint32_t phase = phase_[l];
+            const uint32_t phase_increment = phase_increment_[l];
+            uint32_t increment = modulator_phase_increment_[l] + increment_increment[l];
+            if (increment > 0x3ffffffe) {
+                increment = 0x3ffffffe;
+            }
+            modulator_phase_increment_[l] = increment;
+            uint32_t modulator_phase = modulator_phase_[l] + increment;
+            uint32_t square_modulator_phase = modulator_phase_2_[l] + increment;
+            const uint16_t integrator_gain = increment >> 14;
+
+            if (phase < phase_increment) {
+                modulator_phase = kPhaseReset[filter_type];
+            }
+            if ((phase << 1) < (phase_increment << 1)) {
+                polarity_[l] = !polarity_[l];
+                square_modulator_phase = kPhaseReset[(filter_type & 1) + 2];
+            }
+            modulator_phase_[l] = modulator_phase;
+            modulator_phase_2_[l] = square_modulator_phase;
+
+            int32_t carrier = Interpolate824(wav_sine, modulator_phase);
+            int32_t square_carrier = Interpolate824(wav_sine, square_modulator_phase);
+
+            uint16_t saw = ~(phase >> 16);
+            uint16_t double_saw = ~(phase >> 15);
+            uint16_t triangle = (phase >> 15) ^ (phase & 0x80000000 ? 0xffff : 0x0000);
+            uint16_t window = parameter_[1] < 16384 ? saw : triangle;
+
+            int32_t pulse = (square_carrier * double_saw) >> 16;
+            if (polarity_[l]) {
+                pulse = -pulse;
+            }
+            int32_t square_integrator = integrator_[l] + ((pulse * integrator_gain) >> 16);
+            CLIP(square_integrator)
+            integrator_[l] = square_integrator;
+
+            int16_t saw_tri_signal;
+            int16_t square_signal;
+            if (filter_type & 2) {
+                saw_tri_signal = (carrier * window) >> 16;
+                square_signal = pulse;
+            } else {
+                saw_tri_signal = (window * (carrier + 32768) >> 16) - 32768;
+                square_signal = square_integrator;
+                if (filter_type == 1) {
+                    square_signal = (pulse + square_integrator) >> 1;
+                }
+            }
+            sum += Mix(saw_tri_signal, square_signal, balance);
+        }
+        mix[i] = sum;
+    }
+}
+
+void UnisonOscillator::renderFm(int32_t * mix, size_t size) {
+    // DigitalOscillator::Render quantizes the ratio of the FM shapes
+    int16_t parameter_1 = parameter_[1];
+    {
+        uint16_t integral = parameter_1 >> 8;
+        uint16_t fractional = parameter_1 & 255;
+        int16_t a = lut_fm_frequency_quantizer[integral];
+        int16_t b = lut_fm_frequency_quantizer[integral + 1];
+        parameter_1 = a + ((b - a) * fractional >> 8);
+    }
+    const size_t n = (lanes_ + 3) & ~size_t(3);
+    uint32_t modulator_phase_increment[kLaneStride] = {};
+    for (size_t l = 0; l < lanes_; l++) {
+        modulator_phase_increment[l] = ComputePhaseIncrement(
+            (12 << 7) + lane_pitch_[l] + ((parameter_1 - 16384) >> 1)) >> 1;
+    }
+
+    BEGIN_INTERPOLATE_PARAMETER_0
+
+    for (size_t i = 0; i < size; i++) {
+        INTERPOLATE_PARAMETER_0
+
+        advance(phase_, phase_increment_, n);
+        advance(modulator_phase_, modulator_phase_increment, n);
+        int32_t sum = 0;
+        for (size_t l = 0; l < lanes_; l++) {
+            uint32_t pm = (Interpolate824(wav_sine, modulator_phase_[l]) * parameter_0) << 2;
+            sum += Interpolate824(wav_sine, phase_[l] + pm);
+        }
+        mix[i] = sum;
+    }
+
+    END_INTERPOLATE_PARAMETER_0
+}
+
+void UnisonOscillator::renderWavetables(int32_t * mix, size_t size) {
+    // hysteresis of RenderWavetables against single-bit changes of the
+    // wavetable selection
+    if ((parameter_[1] > previous_parameter_[1] + 64)
+        || (parameter_[1] < previous_parameter_[1] - 64)) {
+        previous_parameter_[1] = parameter_[1];
+    }
+    const uint8_t * wave[2];
+    uint32_t wave_pointer;
+    WavetableWaves(parameter_[0], previous_parameter_[1], wave, &wave_pointer);
+
+    // 2x naive oversampling, as in RenderWavetables
+    const size_t n = (lanes_ + 3) & ~size_t(3);
+    uint32_t phase_increment[kLaneStride] = {};
+    for (size_t l = 0; l < lanes_; l++) {
+        phase_increment[l] = phase_increment_[l] >> 1;
+    }
+    for (size_t i = 0; i < size; i++) {
+        int32_t sum = 0;
+        advance(phase_, phase_increment, n);
+        for (size_t l = 0; l < lanes_; l++) {
+            sum += Crossfade(wave[0], wave[1], phase_[l] >> 1, wave_pointer) >> 1;
+        }
+        advance(phase_, phase_increment, n);
+        for (size_t l = 0; l < lanes_; l++) {
+            sum += Crossfade(wave[0], wave[1], phase_[l] >> 1, wave_pointer) >> 1;
+        }
+        mix[i] = sum;
+    }
+}
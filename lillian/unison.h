@@ -0,0 +1,157 @@
+#pragma once
+/*
+ *  File: unison.h
+ *
+ *  unison of detuned oscillator copies
+ *
+ *  A MacroOscillator that can render up to kMaxUnison copies of its shape
+ *  at pitches spread symmetrically around its own, and mix them with a
+ *  gain of 1/sqrt(copies). With one copy it is a plain MacroOscillator.
+ *  Off unless the build raises LILLIAN_UNISON.
+ *
+ *  The shapes whose kernel keeps only a few phases and reads shared tables
+ *  (triple ring mod, the four digital filters, FM and wavetables) are
+ *  rendered by ports of their DigitalOscillator kernels (unison.cc) that
+ *  keep the copies' state as one array per member, so that the phases of
+ *  all copies advance together in SIMD registers and the per-block work
+ *  (parameter interpolation, wave selection) is done once. The other
+ *  shapes render one MacroOscillator per copy, one after the other.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "stmlib/stmlib.h"
+#include "braids/macro_oscillator.h"
+
+// Most copies of a voice's oscillator (1: no unison). Every copy is a
+// MacroOscillator, so this multiplies the oscillator memory of a voice.
+#ifndef LILLIAN_UNISON
+#define LILLIAN_UNISON 1
+#endif
+
+class UnisonOscillator {
+public:
+    static const size_t kMaxUnison = LILLIAN_UNISON;
+    static const int32_t kMaxDetune = 100;  // cents
+    static const int32_t kDefaultDetune = 25;
+    static const size_t kBlockSize = 24;    // size of temp_buffer in macro_oscillator.h
+
+    void Init() {
+        for (size_t l = 0; l < kMaxUnison; l++) {
+            lane_[l].Init();
+        }
+        shape_ = braids::MACRO_OSC_SHAPE_CSAW;
+        pitch_ = 0;
+        parameter_[0] = parameter_[1] = 0;
+        lanes_ = 1;
+        detune_ = kDefaultDetune;
+        setOffsets();
+        reset_ = true;
+    }
+
+    inline void set_shape(braids::MacroOscillatorShape shape) {
+        for (size_t l = 0; l < kMaxUnison; l++) {
+            lane_[l].set_shape(shape);
+        }
+        if (shape != shape_) {
+            shape_ = shape;
+            reset_ = true;
+        }
+    }
+
+    inline void set_pitch(int16_t pitch) {
+        pitch_ = pitch;
+        lane_[0].set_pitch(pitch);
+    }
+
+    inline void set_parameters(int16_t parameter_1, int16_t parameter_2) {
+        parameter_[0] = parameter_1;
+        parameter_[1] = parameter_2;
+        lane_[0].set_parameters(parameter_1, parameter_2);
+    }
+
+    // copies: 0 or 1 for a single oscillator, up to kMaxUnison; detune:
+    // pitch difference of the outermost copies to the note, in cents. At
+    // detune 0 the copies would only add up to a louder, clipping copy of
+    // one, so a single one is rendered.
+    inline void set_unison(int32_t copies, int32_t detune) {
+        CONSTRAIN(copies, 1, static_cast<int32_t>(kMaxUnison));
+        CONSTRAIN(detune, 0, kMaxDetune);
+        if (detune == 0) {
+            copies = 1;
+        }
+        if (static_cast<size_t>(copies) != lanes_) {
+            lanes_ = copies;
+            reset_ = true;
+        }
+        detune_ = detune;
+        setOffsets();
+    }
+
+    inline void Strike() {
+        for (size_t l = 0; l < kMaxUnison; l++) {
+            lane_[l].Strike();
+        }
+    }
+
+    inline size_t copies() const {
+        return lanes_;
+    }
+
+    // Shapes rendered by the lane-packed kernels.
+    static inline bool packed(braids::MacroOscillatorShape shape) {
+        return shape == braids::MACRO_OSC_SHAPE_TRIPLE_RING_MOD
+            || (shape >= braids::MACRO_OSC_SHAPE_DIGITAL_FILTER_LP
+                && shape <= braids::MACRO_OSC_SHAPE_DIGITAL_FILTER_HP)
+            || shape == braids::MACRO_OSC_SHAPE_FM
+            || shape == braids::MACRO_OSC_SHAPE_WAVETABLES;
+    }
+
+    // size: at most kBlockSize. The packed kernels have no sync input: a
+    // block with a sync pulse renders the copies one after the other.
+    void Render(const uint8_t * sync, int16_t * buffer, size_t size);
+
+private:
+    // lanes of the packed kernels, padded to whole SIMD vectors
+    static const size_t kLaneStride = (kMaxUnison + 3) & ~size_t(3);
+
+    inline void setOffsets() {
+        // in 1/128 semitone, from -detune to +detune
+        const int32_t spread = detune_ * 128 / 100;
+        for (size_t l = 0; l < kMaxUnison; l++) {
+            offset_[l] = (lanes_ > 1)
+                ? spread * (2 * static_cast<int32_t>(l) - static_cast<int32_t>(lanes_ - 1))
+                    / static_cast<int32_t>(lanes_ - 1)
+                : 0;
+        }
+    }
+
+    void renderSequential(const uint8_t * sync, int32_t * mix, size_t size);
+    void renderPacked(int32_t * mix, size_t size);
+    void renderTripleRingMod(int32_t * mix, size_t size);
+    void renderDigitalFilter(int32_t * mix, size_t size);
+    void renderFm(int32_t * mix, size_t size);
+    void renderWavetables(int32_t * mix, size_t size);
+
+    braids::MacroOscillator lane_[kMaxUnison];
+    braids::MacroOscillatorShape shape_;
+    int16_t pitch_;
+    int16_t parameter_[2];
+    size_t lanes_;
+    uint16_t detune_;
+    int16_t offset_[kMaxUnison];
+    bool reset_;  // the packed state starts over at the next Render
+
+    // state of the packed kernels, one array per DigitalOscillator member
+    int16_t previous_parameter_[2];
+    int16_t lane_pitch_[kLaneStride];
+    uint32_t phase_[kLaneStride];
+    uint32_t phase_increment_[kLaneStride];
+    uint32_t modulator_phase_[kLaneStride];
+    uint32_t modulator_phase_2_[kLaneStride];  // square modulator of the digital filters
+    uint32_t modulator_phase_increment_[kLaneStride];
+    int32_t integrator_[kLaneStride];
+    uint8_t polarity_[kLaneStride];
+};
@@ -9,11 +9,15 @@
 #include <cstddef>
 #include <cstdint>
 
+#include <algorithm>
+
 #include "unit.h"   // Note: Include common definitions for all units
 #include "synth.h"  // Note: Include custom master fx code
+#include "unit_ext.h"
 
 static Synth s_synth_instance;              // Note: In this case, actual instance of custom master fx object.
 static unit_runtime_desc_t s_runtime_desc;  // Note: used to cache runtime descriptor obtained via init callback
+static uint16_t s_event_offset;             // frames into the next unit_render, see unit_set_event_offset
 
 // ---- Callback entry points from drumlogue runtime ----------------------------------------------
 
@@ -36,7 +40,7 @@ __unit_callback void unit_teardown() {
 }
 
 __unit_callback void unit_reset() {
-  s_synth_instance.Reset();
+  s_synth_instance.PostReset();
 }
 
 __unit_callback void unit_resume() {
@@ -50,14 +54,15 @@ __unit_callback void unit_suspend() {
 __unit_callback void unit_render(const float * in, float * out, uint32_t frames) {
   (void)in;
   s_synth_instance.Render(out, frames);
+  s_event_offset = 0;
 }
 
 __unit_callback void unit_set_param_value(uint8_t id, int32_t value) {
-  s_synth_instance.setParameter(id, value);
+  s_synth_instance.PostParameter(id, value);
 }
 
 __unit_callback int32_t unit_get_param_value(uint8_t id) {
-  return s_synth_instance.getParameterValue(id);
+  return s_synth_instance.getPostedParameterValue(id);
 }
 
 __unit_callback const char * unit_get_param_str_value(uint8_t id, int32_t value) {
@@ -72,24 +77,27 @@ __unit_callback void unit_set_tempo(uint32_t tempo) {
     s_synth_instance.SetTempo(tempo);
 }
 
+// Sample-accurate offsets exist only in the host build. The drumlogue runtime
+// never calls unit_set_event_offset, so on the device these callbacks post
+// offset 0 and the event applies from the start of the next unit_render.
 __unit_callback void unit_note_on(uint8_t note, uint8_t velocity) {
-  s_synth_instance.NoteOn(note, velocity);
+  s_synth_instance.PostNoteOn(note, velocity, s_event_offset);
 }
 
 __unit_callback void unit_note_off(uint8_t note) {
-  s_synth_instance.NoteOff(note);
+  s_synth_instance.PostNoteOff(note, s_event_offset);
 }
 
 __unit_callback void unit_gate_on(uint8_t velocity) {
-  s_synth_instance.GateOn(velocity);
+  s_synth_instance.PostGateOn(velocity, s_event_offset);
 }
 
 __unit_callback void unit_gate_off() {
-  s_synth_instance.GateOff();
+  s_synth_instance.PostGateOff(s_event_offset);
 }
 
 __unit_callback void unit_all_note_off() {
-  s_synth_instance.AllNoteOff();
+  s_synth_instance.PostAllNoteOff(s_event_offset);
 }
 
 __unit_callback void unit_pitch_bend(uint16_t bend) {
@@ -105,7 +113,7 @@ __unit_callback void unit_aftertouch(uint8_t note, uint8_t aftertouch) {
 }
 
 __unit_callback void unit_load_preset(uint8_t idx) {
-  return s_synth_instance.LoadPreset(idx);
+  return s_synth_instance.PostLoadPreset(idx);
 }
 
 __unit_callback uint8_t unit_get_preset_index() {
@@ -115,3 +123,13 @@ __unit_callback uint8_t unit_get_preset_index() {
 __unit_callback const char * unit_get_preset_name(uint8_t idx) {
   return Synth::getPresetName(idx);
 }
+
+void unit_set_event_offset(uint32_t frames) {
+  s_event_offset = std::min<uint32_t>(frames, UINT16_MAX);
+}
+
+#ifdef LILLIAN_RENDER_STATS
+void unit_get_render_stats(RenderStatsSnapshot * stats) {
+  s_synth_instance.getRenderStats(*stats);
+}
+#endif
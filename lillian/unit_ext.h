@@ -0,0 +1,24 @@
+#pragma once
+/*
+ *  File: unit_ext.h
+ *
+ *  host extensions of the unit interface
+ *
+ *  Not part of the logue SDK: functions unit.cc exports next to the
+ *  unit_* callbacks, for the host tools. The drumlogue runtime never calls
+ *  them.
+ *
+ */
+
+#include <cstdint>
+
+#include "render_stats.h"
+
+// Timestamps the note and gate callbacks that follow with frames from
+// the start of the next unit_render.
+void unit_set_event_offset(uint32_t frames);
+
+#ifdef LILLIAN_RENDER_STATS
+// Reads the stats of the unit instance.
+void unit_get_render_stats(RenderStatsSnapshot * stats);
+#endif